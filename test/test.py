@@ -37,9 +37,9 @@ def BUI_gen_lcg(seed:int,len_:int,bit_masks:list[int]=[UMAX],mult:int=0x5DEECE66
     for _ in range(len_):
         seed = (seed*mult+add)&UMAX
         mask = bit_masks[(seed>>32)%len(bit_masks)]
-        seed = (seed*mult+add)%UMAX
+        seed = (seed*mult+add)&UMAX
         tmp = seed>>32
-        seed = (seed*mult+add)%UMAX
+        seed = (seed*mult+add)&UMAX
         tmp |= seed&0xFFFFFFFF00000000
         ret.append(tmp&mask)
     return arr_to_BUI(ret)
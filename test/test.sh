@@ -1,4 +1,4 @@
 #!/bin/bash
-g++ -g -Wall -Werror -Wextra \
+g++ -g -Wall -Werror -Wextra -pthread \
     -march=native ../u64arr/u64arr_ll.cpp u64arr_ll_test.cpp \
     && valgrind ./a.out
@@ -7,8 +7,12 @@
 
 #include <algorithm>
 #include <array>
+#include <string>
+#include <thread>
 #include <vector>
 
+#include <unistd.h>
+
 #include "../u64arr/u64arr_ll.hpp"
 #include "../utils/fastmod.h"
 
@@ -128,7 +132,7 @@ uint32_t crc32(const uint8_t *buf, size_t len)
     return crc<uint32_t,0xEDB88320,0xFFFFFFFF,0xFFFFFFFF>(buf,len);
 }
 
-uint32_t crc64(const uint8_t *buf, size_t len)
+uint64_t crc64(const uint8_t *buf, size_t len)
 {
     return crc<uint64_t,0xC96C5795D7870F42uLL,0xFFFFFFFFFFFFFFFFuLL,
         0xFFFFFFFFFFFFFFFFuLL>(buf,len);
@@ -435,6 +439,78 @@ void test_u64arr_ll_mul_64()
     assert(BUI_eq(a,{15454450193228165082uLL,8151940110614728324uLL}));
 }
 
+void test_u64arr_ll_addmul_64()
+{
+    printf("test_u64arr_ll_addmul_64()\n");
+    BUI a = {UMAX,UMAX};
+    BUI b = {UMAX,UMAX};
+    uint64_t ret = u64arr_ll_addmul_64(a.data(),b.data(),2,UMAX);
+    assert(ret == UMAX);
+    assert(BUI_eq(a,{0,UMAX}));
+    a = {3,5,7};
+    b = {11,13,17};
+    ret = u64arr_ll_addmul_64(a.data(),b.data(),3,_m61);
+    assert(ret == 2);
+    assert(BUI_eq(a,{6917529027641081848uLL,11529215046068469753uLL,
+                     2305843009213693943uLL}));
+    // same as adding the product from u64arr_ll_mul
+    BUI x(40,0), y(40,0), p(41);
+    for (size_t i = 0; i < 40; ++i)
+    {
+        x[i] = 0x9E3779B97F4A7C15uLL * (i+1);
+        y[i] = 0xC2B2AE3D27D4EB4FuLL * (i+3);
+    }
+    BUI z = x;
+    uint64_t v = 0x165667B19E3779F9uLL;
+    u64arr_ll_mul(y.data(),40,&v,1,p.data());
+    bool c = u64arr_ll_add_to(p.data(),41,x.data(),40);
+    assert(!c);
+    ret = u64arr_ll_addmul_64(z.data(),y.data(),40,v);
+    z.push_back(ret);
+    assert(BUI_eq(z,p));
+}
+
+void test_u64arr_ll_submul_64()
+{
+    printf("test_u64arr_ll_submul_64()\n");
+    BUI a = {UMAX,UMAX};
+    BUI b = {1,1};
+    uint64_t ret = u64arr_ll_submul_64(a.data(),b.data(),2,UMAX);
+    assert(ret == 0);
+    assert(BUI_eq(a,{0,0}));
+    a = {3,5,7};
+    b = {11,13,17};
+    ret = u64arr_ll_submul_64(a.data(),b.data(),3,_m61);
+    assert(ret == 3);
+    assert(BUI_eq(a,{11529215046068469774uLL,6917529027641081872uLL,
+                     16140901064495857686uLL}));
+    // undoes u64arr_ll_addmul_64
+    b = {UMAX,UMAX-1,12345};
+    BUI x = a;
+    uint64_t c = u64arr_ll_addmul_64(a.data(),b.data(),3,UMAX-2);
+    ret = u64arr_ll_submul_64(a.data(),b.data(),3,UMAX-2);
+    assert(ret == c);
+    assert(BUI_eq(a,x));
+}
+
+void test_u64arr_ll_addmul_2()
+{
+    printf("test_u64arr_ll_addmul_2()\n");
+    BUI a = {UMAX,UMAX,0};
+    BUI b = {UMAX,UMAX};
+    BUI v = {UMAX,UMAX};
+    uint64_t ret = u64arr_ll_addmul_2(a.data(),b.data(),2,v.data());
+    assert(ret == UMAX);
+    assert(BUI_eq(a,{0,0,UMAX}));
+    a = {3,5,UMAX};
+    b = {11,13};
+    v = {_m61,_m31};
+    ret = u64arr_ll_addmul_2(a.data(),b.data(),2,v.data());
+    assert(ret == 0);
+    assert(BUI_eq(a,{6917529027641081848uLL,11529215069690789870uLL,
+                     27917287412uLL}));
+}
+
 void test_u64arr_ll_div_32()
 {
     printf("test_u64arr_ll_div_32()\n");
@@ -488,6 +564,116 @@ void test_u64arr_ll_div_64()
     assert(BUI_eq(a,{13072324724826654137uLL,129447444992748109uLL,0,0}));
 }
 
+void test_u64arr_ll_div_64_pre()
+{
+    printf("test_u64arr_ll_div_64_pre()\n");
+    u64arr_ll_divisor_64 dv;
+    u64arr_ll_divisor_64_init(&dv,73000000000000uLL);
+    BUI a = {14722052863563208240uLL,2844907266022922488uLL,
+             15977678935670796422uLL,3967148191121uLL};
+    uint64_t ret = u64arr_ll_mod_64_pre(a.data(),4,&dv);
+    assert(ret == 67850737755696uLL);
+    ret = u64arr_ll_div_64_pre(a.data(),4,&dv);
+    assert(ret == 67850737755696uLL);
+    assert(BUI_eq(a,{12113468845911842103uLL,4722885315982888144uLL,
+                     1002479005261710302uLL,0}));
+    a = {UMAX,UMAX};
+    u64arr_ll_divisor_64_init(&dv,UMAX);
+    ret = u64arr_ll_div_64_pre(a.data(),2,&dv);
+    assert(ret == 0);
+    assert(BUI_eq(a,{1,1}));
+    a = {UMAX,UMAX};
+    u64arr_ll_divisor_64_init(&dv,1);
+    ret = u64arr_ll_div_64_pre(a.data(),2,&dv);
+    assert(ret == 0);
+    assert(BUI_eq(a,{UMAX,UMAX}));
+    // check q*d+r == n and r < d for various divisors
+    BUI divisors = {1,2,3,10,1uLL<<32,(1uLL<<32)+1,1000000000000037uLL,
+                    (1uLL<<63)-1,1uLL<<63,(1uLL<<63)+1,UMAX-1,UMAX};
+    for (uint64_t d : divisors)
+    {
+        u64arr_ll_divisor_64_init(&dv,d);
+        for (size_t l : {1,2,3,7,50})
+        {
+            BUI n = BUI_gen_lcg(d+l,l,masks_for_mul);
+            BUI q = n;
+            uint64_t r = u64arr_ll_mod_64_pre(n.data(),l,&dv);
+            assert(r < d);
+            assert(u64arr_ll_div_64_pre(q.data(),l,&dv) == r);
+            bool o = u64arr_ll_mul_64(q.data(),l,d);
+            assert(!o);
+            o = u64arr_ll_add_64(q.data(),l,r);
+            assert(!o);
+            assert(BUI_eq(q,n));
+        }
+    }
+}
+
+void test_u64arr_ll_mod_64()
+{
+    printf("test_u64arr_ll_mod_64()\n");
+    BUI a = {14722052863563208240uLL,2844907266022922488uLL,
+             15977678935670796422uLL,3967148191121uLL};
+    assert(u64arr_ll_mod_64(a.data(),4,73000000000000uLL) == 67850737755696uLL);
+    assert(u64arr_ll_mod_64(a.data(),0,7) == 0);
+    // largest limbs for the largest sums when folding
+    a = BUI(21,UMAX);
+    assert(u64arr_ll_mod_64(a.data(),21,UMAX-58) == 9288698934338363843uLL);
+    assert(u64arr_ll_mod_64(a.data(),21,(1uLL<<63)+1) == 9223372036852678656uLL);
+    assert(u64arr_ll_mod_64(a.data(),21,UMAX) == 0);
+    assert(u64arr_ll_mod_64(a.data(),21,3) == 0);
+    // compare with u64arr_ll_div_64 (input not modified)
+    BUI divisors = {1,2,3,10,1uLL<<32,(1uLL<<32)+1,1000000000000037uLL,
+                    (1uLL<<63)-1,1uLL<<63,(1uLL<<63)+1,UMAX-1,UMAX};
+    for (uint64_t d : divisors)
+    {
+        for (size_t l : {1,15,16,17,18,19,64,1001})
+        {
+            BUI n = BUI_gen_lcg(d+l,l,masks_for_mul);
+            BUI q = n;
+            uint64_t r = u64arr_ll_mod_64(n.data(),l,d);
+            assert(u64arr_ll_div_64(q.data(),l,d) == r);
+            assert(BUI_eq(n,BUI_gen_lcg(d+l,l,masks_for_mul)));
+        }
+    }
+}
+
+// compare u64arr_ll_div_const<D> with u64arr_ll_div_64
+template <uint64_t D>
+void test_div_const()
+{
+    for (size_t l : {1,2,3,7,50})
+    {
+        BUI n = BUI_gen_lcg(D+l,l,masks_for_mul);
+        BUI q = n;
+        uint64_t r = u64arr_ll_div_const<D>(n.data(),l);
+        assert(u64arr_ll_div_64(q.data(),l,D) == r);
+        assert(BUI_eq(q,n));
+    }
+}
+
+void test_u64arr_ll_div_const()
+{
+    printf("test_u64arr_ll_div_const()\n");
+    BUI a = {14722052863563208240uLL,2844907266022922488uLL,
+             15977678935670796422uLL,3967148191121uLL};
+    uint64_t ret = u64arr_ll_div_const<73000000000000uLL>(a.data(),4);
+    assert(ret == 67850737755696uLL);
+    assert(BUI_eq(a,{12113468845911842103uLL,4722885315982888144uLL,
+                     1002479005261710302uLL,0}));
+    test_div_const<1>();
+    test_div_const<2>();
+    test_div_const<3>();
+    test_div_const<10>();
+    test_div_const<16>();
+    test_div_const<1000000007uLL>();
+    test_div_const<10000000000000000000uLL>(); // 10^19
+    test_div_const<12157665459056928801uLL>(); // 3^40
+    test_div_const<1uLL<<63>();
+    test_div_const<(1uLL<<63)+1>();
+    test_div_const<UMAX>();
+}
+
 void test_u64arr_ll_write_str()
 {
     printf("test_u64arr_ll_write_str()\n");
@@ -515,6 +701,14 @@ void test_u64arr_ll_write_str()
     ret = u64arr_ll_write_str(2,false,a.data(),2,s);
     assert(ret == 1);
     assert(!strcmp(s,"0"));
+    a = a2;
+    ret = u64arr_ll_write_str(8,false,a.data(),3,s);
+    assert(ret == 48);
+    assert(!strcmp(s,"342463411211576023346750305500375167144037212745"));
+    a = a2;
+    ret = u64arr_ll_write_str(16,true,a.data(),3,s);
+    assert(ret == 36);
+    assert(!strcmp(s,"714CE1289BF04DCDE862D01FA773207D15E5"));
     a = {12157665459056928801uLL}; // 3^40
     ret = u64arr_ll_write_str(2,false,a.data(),1,s);
     assert(ret == 64);
@@ -534,6 +728,65 @@ void test_u64arr_ll_write_str()
     assert(!strcmp(s,"993A16326A55A1898567"));
 }
 
+// digits by repeated division, for comparison with divide and conquer
+std::string write_str_simple(uint8_t base, BUI n)
+{
+    std::string ret;
+    size_t l = n.size();
+    while (l and n[l-1] == 0)
+        --l;
+    while (l)
+    {
+        ret += "0123456789abcdefghijklmnopqrstuvwxyz"[
+            u64arr_ll_div_64(n.data(),l,base)];
+        if (n[l-1] == 0)
+            --l;
+    }
+    if (ret.empty())
+        ret = "0";
+    std::reverse(ret.begin(),ret.end());
+    return ret;
+}
+
+void test_u64arr_ll_write_str_dc()
+{
+    printf("test_u64arr_ll_write_str_dc()\n");
+    std::vector<char> s(50000);
+    for (uint8_t base : {3,7,10,16,36})
+    {
+        for (size_t l : {29,30,31,64,100,517})
+        {
+            BUI a = BUI_gen_lcg(base+l,l,masks_for_mul);
+            std::string e = write_str_simple(base,a);
+            BUI b = a;
+            size_t ret = u64arr_ll_write_str(base,false,b.data(),l,s.data());
+            assert(ret == e.size());
+            assert(e == s.data());
+            b = a;
+            ret = u64arr_ll_write_str_mt(base,false,b.data(),l,s.data(),4);
+            assert(ret == e.size());
+            assert(e == s.data());
+        }
+    }
+    // zero runs in the inner chunks
+    for (const char *c : {"1","9"})
+    {
+        std::string e = c + std::string(3000,c[0] == '1' ? '0' : '9');
+        BUI a(200);
+        size_t l = u64arr_ll_read_str(10,e.c_str(),a.data());
+        size_t ret = u64arr_ll_write_str(10,false,a.data(),l,s.data());
+        assert(ret == e.size());
+        assert(e == s.data());
+    }
+    // parallel
+    BUI a = BUI_gen_lcg(2100,2100,masks_for_mul);
+    std::string e = write_str_simple(10,a);
+    size_t ret = u64arr_ll_write_str_mt(10,false,a.data(),2100,s.data(),4);
+    assert(ret == e.size());
+    assert(e == s.data());
+    assert(BUI_eq(a,{0}));
+}
+
 void test_u64arr_ll_read_str()
 {
     printf("test_u64arr_ll_read_str()\n");
@@ -574,6 +827,343 @@ void test_u64arr_ll_read_str()
     ret = u64arr_ll_read_str(11,"993A16326A55A1898567",a.data());
     assert(ret == 2);
     assert(BUI_eq(a,{12157665459056928801uLL,32}));
+    // lengths around multiples of 19 digits (chunks of 10^19)
+    a = {0,0,0};
+    ret = u64arr_ll_read_str(10,("1"+std::string(19,'0')).c_str(),a.data());
+    assert(ret == 1);
+    assert(BUI_eq(a,{10000000000000000000uLL}));
+    ret = u64arr_ll_read_str(10,("1"+std::string(20,'0')).c_str(),a.data());
+    assert(ret == 2);
+    assert(BUI_eq(a,{7766279631452241920uLL,5}));
+    ret = u64arr_ll_read_str(10,("1"+std::string(38,'0')).c_str(),a.data());
+    assert(ret == 2);
+    assert(BUI_eq(a,{687399551400673280uLL,5421010862427522170uLL}));
+    ret = u64arr_ll_read_str(10,("1"+std::string(39,'0')).c_str(),a.data());
+    assert(ret == 3);
+    assert(BUI_eq(a,{6873995514006732800uLL,17316620476856118468uLL,2}));
+    a = {0,0,0};
+    ret = u64arr_ll_read_str(10,(std::string(40,'0')+"12").c_str(),a.data());
+    assert(ret == 1);
+    assert(BUI_eq(a,{12}));
+}
+
+void test_u64arr_ll_read_str_dc()
+{
+    printf("test_u64arr_ll_read_str_dc()\n");
+    for (uint8_t base : {3,7,10,16,36})
+    {
+        for (size_t l : {29,30,31,64,100,517,2100})
+        {
+            BUI a = BUI_gen_lcg(base+l,l,masks_for_mul);
+            std::string e = write_str_simple(base,a);
+            BUI b(l+1);
+            size_t ret = u64arr_ll_read_str(base,e.c_str(),b.data());
+            assert(ret == l);
+            assert(BUI_eq(a,b));
+            // leading zeros
+            e = std::string(1000,'0') + e;
+            b = BUI(l+20);
+            ret = u64arr_ll_read_str(base,e.c_str(),b.data());
+            assert(ret == l);
+            assert(BUI_eq(a,b));
+        }
+    }
+    BUI a(100,UMAX);
+    size_t ret = u64arr_ll_read_str(10,std::string(5000,'0').c_str(),a.data());
+    assert(ret == 1);
+    assert(a[0] == 0);
+}
+
+void test_u64arr_ll_str_pow2()
+{
+    printf("test_u64arr_ll_str_pow2()\n");
+    std::vector<char> s(20000);
+    for (uint8_t base : {2,4,8,16,32})
+    {
+        for (size_t l : {1,2,3,5,64,100})
+        {
+            BUI a = BUI_gen_lcg(base+l,l,masks_for_mul);
+            for (int k = 0; k < 2; ++k)
+            {
+                if (k) // top limb with few bits
+                    a[l-1] = 5;
+                std::string e = write_str_simple(base,a);
+                BUI b = a;
+                size_t ret = u64arr_ll_write_str(base,false,b.data(),l,s.data());
+                assert(ret == e.size());
+                assert(e == s.data());
+                assert(b == a); // not modified
+                b = BUI(l);
+                ret = u64arr_ll_read_str(base,("000"+e).c_str(),b.data());
+                assert(ret == l);
+                assert(b == a);
+            }
+        }
+    }
+    BUI a(3,UMAX);
+    size_t ret = u64arr_ll_read_str(16,"0000",a.data());
+    assert(ret == 1);
+    assert(a[0] == 0);
+    ret = u64arr_ll_read_str(32,"FVVVVVVVVVVVV",a.data());
+    assert(ret == 1);
+    assert(a[0] == UMAX);
+    ret = u64arr_ll_read_str(32,"G000000000000",a.data());
+    assert(ret == 2);
+    assert(a[0] == 0 and a[1] == 1);
+}
+
+void test_u64arr_ll_str_chunks()
+{
+    printf("test_u64arr_ll_str_chunks()\n");
+    std::vector<char> s(20000);
+    // all 9s fill every digit position of the decimal chunks
+    for (size_t k : {1,16,18,19,20,38,57,400,1500})
+    {
+        std::string e(k,'9');
+        BUI a(k/19+2);
+        size_t l = u64arr_ll_read_str(10,e.c_str(),a.data());
+        assert(l);
+        size_t ret = u64arr_ll_write_str(10,false,a.data(),l,s.data());
+        assert(ret == k);
+        assert(e == s.data());
+    }
+    // mixed case hex of every length around the 16 and 32 digit blocks
+    const char *hex = "0123456789abcdefABCDEF";
+    uint64_t r = 7;
+    for (size_t k = 1; k < 100; ++k)
+    {
+        std::string e, lower;
+        for (size_t i = 0; i < k; ++i)
+        {
+            r = r*6364136223846793005uLL + 1442695040888963407uLL;
+            e += hex[(r >> 33) % 22];
+            lower += tolower(e.back());
+        }
+        e[0] = lower[0] = 'f';
+        BUI a((k+15)/16);
+        size_t l = u64arr_ll_read_str(16,e.c_str(),a.data());
+        assert(l == a.size());
+        size_t ret = u64arr_ll_write_str(16,false,a.data(),l,s.data());
+        assert(ret == k);
+        assert(lower == s.data());
+        std::string upper = lower;
+        for (char &c : upper)
+            c = toupper(c);
+        ret = u64arr_ll_write_str(16,true,a.data(),l,s.data());
+        assert(upper == s.data());
+    }
+}
+
+void test_u64arr_ll_read_str_invalid()
+{
+    printf("test_u64arr_ll_read_str_invalid()\n");
+    BUI a(200);
+    for (uint8_t base : {2,3,8,10,16,32,36})
+    {
+        // the largest digit is valid, the next character is not
+        char top = base <= 10 ? '0'+base-1 : 'a'+base-11;
+        std::string bad = "/:@[`{ \x80\xff";
+        if (base < 36)
+            bad += top+1;
+        for (size_t len : {1,5,17,40,100,2000})
+        {
+            std::string e(len,top);
+            for (size_t i : {(size_t)0,len/2,len-1})
+            {
+                for (char c : bad)
+                {
+                    std::string f = e;
+                    f[i] = c;
+                    a.assign(200,0);
+                    size_t ret = u64arr_ll_read_str(base,f.c_str(),a.data());
+                    assert(ret == 0);
+                }
+            }
+            size_t ret = u64arr_ll_read_str(base,e.c_str(),a.data());
+            assert(ret);
+        }
+    }
+}
+
+// collects the digits of u64arr_ll_write_str_cb, stops after limit calls
+struct str_collect
+{
+    std::string s;
+    size_t calls, limit;
+};
+
+bool str_collect_out(void *ctx, const char *s, size_t len)
+{
+    str_collect *c = (str_collect*)ctx;
+    c->s.append(s,len);
+    return ++c->calls < c->limit;
+}
+
+void test_u64arr_ll_str_stream()
+{
+    printf("test_u64arr_ll_str_stream()\n");
+    for (uint8_t base : {2,3,8,10,16,32,36})
+    {
+        for (size_t l : {0,1,5,30,64,129,700,2100})
+        {
+            BUI a = BUI_gen_lcg(base+l,l,masks_for_mul);
+            if (l > 2) // zero limbs in the middle
+                a[l/2] = a[l/2+1] = 0;
+            std::string e = l ? write_str_simple(base,a) : "0";
+            BUI b = a;
+            str_collect c = {"",0,SIZE_MAX};
+            size_t ret = u64arr_ll_write_str_cb(base,false,b.data(),l,
+                                                str_collect_out,&c);
+            assert(ret == e.size());
+            assert(c.s == e);
+            // stopped by the callback
+            if (c.calls > 1)
+            {
+                b = a;
+                str_collect d = {"",0,1};
+                ret = u64arr_ll_write_str_cb(base,false,b.data(),l,
+                                             str_collect_out,&d);
+                assert(ret == 0 and d.calls == 1);
+            }
+            // fed in pieces of varying size, with leading zeros
+            e = "00" + e;
+            u64arr_ll_str_reader rd;
+            u64arr_ll_str_reader_init(&rd,base);
+            for (size_t i = 0, k = 1; i < e.size(); i += k, k = 3*k%1000+1)
+                assert(u64arr_ll_str_reader_feed(&rd,e.c_str()+i,
+                                                 std::min(k,e.size()-i)));
+            b = BUI(u64arr_ll_str_reader_limbs(&rd));
+            ret = u64arr_ll_str_reader_finish(&rd,b.data());
+            assert(ret == std::max(l,(size_t)1));
+            assert(BUI_eq(a,b));
+        }
+    }
+    // invalid characters
+    u64arr_ll_str_reader rd;
+    u64arr_ll_str_reader_init(&rd,10);
+    std::string e(5000,'7');
+    e[4000] = 'a';
+    assert(!u64arr_ll_str_reader_feed(&rd,e.c_str(),e.size()));
+    assert(u64arr_ll_str_reader_finish(&rd,nullptr) == 0);
+    u64arr_ll_str_reader_init(&rd,10);
+    assert(u64arr_ll_str_reader_feed(&rd,"123",3));
+    assert(u64arr_ll_str_reader_feed(&rd,"4x",2)); // in the incomplete block
+    assert(u64arr_ll_str_reader_finish(&rd,nullptr) == 0);
+    // nothing fed is 0
+    BUI a = {5};
+    u64arr_ll_str_reader_init(&rd,10);
+    assert(u64arr_ll_str_reader_finish(&rd,a.data()) == 1);
+    assert(a[0] == 0);
+}
+
+void test_u64arr_ll_str_fd()
+{
+    printf("test_u64arr_ll_str_fd()\n");
+    for (uint8_t base : {10,16})
+    {
+        size_t l = 3000;
+        BUI a = BUI_gen_lcg(base,l,masks_for_mul);
+        std::string e = write_str_simple(base,a);
+        // regular file (mapped)
+        FILE *f = tmpfile();
+        int fd = fileno(f);
+        BUI b = a;
+        size_t ret = u64arr_ll_write_str_fd(base,true,b.data(),l,fd);
+        assert(ret == e.size());
+        assert(lseek(fd,0,SEEK_SET) == 0);
+        u64arr_ll_str_reader rd;
+        u64arr_ll_str_reader_init(&rd,base);
+        assert(u64arr_ll_str_reader_feed_fd(&rd,fd));
+        b = BUI(u64arr_ll_str_reader_limbs(&rd));
+        ret = u64arr_ll_str_reader_finish(&rd,b.data());
+        assert(ret == l);
+        assert(BUI_eq(a,b));
+        fclose(f);
+        // pipe (read in blocks), small enough to not block the writer
+        int p[2];
+        assert(pipe(p) == 0);
+        BUI c(50);
+        std::copy(a.begin(),a.begin()+50,c.begin());
+        e = write_str_simple(base,c);
+        ret = u64arr_ll_write_str_fd(base,false,c.data(),50,p[1]);
+        assert(ret == e.size());
+        close(p[1]);
+        u64arr_ll_str_reader_init(&rd,base);
+        assert(u64arr_ll_str_reader_feed_fd(&rd,p[0]));
+        b = BUI(u64arr_ll_str_reader_limbs(&rd));
+        ret = u64arr_ll_str_reader_finish(&rd,b.data());
+        close(p[0]);
+        assert(ret == 50);
+        assert(std::equal(b.begin(),b.begin()+50,a.begin()));
+    }
+    // write error
+    int p[2];
+    assert(pipe(p) == 0);
+    close(p[0]);
+    close(p[1]);
+    BUI a = {12345};
+    assert(u64arr_ll_write_str_fd(10,false,a.data(),1,p[1]) == 0);
+}
+
+void test_u64arr_ll_str_cache()
+{
+    printf("test_u64arr_ll_str_cache()\n");
+    size_t l = 3000;
+    BUI a = BUI_gen_lcg(77,l,masks_for_mul);
+    std::string e = write_str_simple(10,a);
+    // convert both ways, checking the results
+    auto check = [&](uint8_t base, const std::string &e)
+    {
+        BUI b = a;
+        std::vector<char> s(e.size()+1);
+        size_t ret = u64arr_ll_write_str(base,false,b.data(),l,s.data());
+        assert(ret == e.size());
+        assert(e == s.data());
+        ret = u64arr_ll_read_str(base,e.c_str(),b.data());
+        assert(ret == l);
+        assert(b == a);
+    };
+    u64arr_ll_str_cache_clear();
+    assert(u64arr_ll_str_cache_size() == 0);
+    check(10,e);
+    size_t c = u64arr_ll_str_cache_size();
+    assert(c > 0);
+    check(10,e); // same powers are reused
+    assert(u64arr_ll_str_cache_size() == c);
+    std::string e7 = write_str_simple(7,a);
+    check(7,e7);
+    assert(u64arr_ll_str_cache_size() > c);
+    // lower limit releases the largest powers
+    u64arr_ll_str_cache_limit(c/2);
+    assert(u64arr_ll_str_cache_size() <= c/2);
+    check(10,e);
+    assert(u64arr_ll_str_cache_size() <= c/2);
+    u64arr_ll_str_cache_limit(0);
+    assert(u64arr_ll_str_cache_size() == 0);
+    check(10,e);
+    assert(u64arr_ll_str_cache_size() == 0);
+    u64arr_ll_str_cache_limit((size_t)1 << 22);
+    // conversions in several threads while the cache is cleared
+    std::vector<std::thread> th;
+    for (int i = 0; i < 4; ++i)
+        th.emplace_back([&,i]
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                if (i % 2)
+                    check(10,e);
+                else
+                    check(7,e7);
+            }
+        });
+    for (int j = 0; j < 20; ++j)
+    {
+        u64arr_ll_str_cache_clear();
+        std::this_thread::yield();
+    }
+    for (auto &t : th)
+        t.join();
+    check(10,e);
 }
 
 struct bigger_test_lcg
@@ -582,7 +1172,7 @@ struct bigger_test_lcg
     uint64_t a_seed, b_seed;
     size_t a_len, b_len;
     // hashes computed from separate python code (do not need to use all)
-    BUI_hash h_add, h_sub, h_mul, h_div, h_mod;
+    BUI_hash h_add, h_sub, h_mul, h_sqr, h_div, h_mod;
     // return value for add/sub tests
     bool r_add, r_sub;
     bigger_test_lcg(uint64_t a_seed, uint64_t b_seed,
@@ -591,6 +1181,7 @@ struct bigger_test_lcg
     void set_h_add(BUI_hash h) { h_add = h; }
     void set_h_sub(BUI_hash h) { h_sub = h; }
     void set_h_mul(BUI_hash h) { h_mul = h; }
+    void set_h_sqr(BUI_hash h) { h_sqr = h; }
     void set_h_div(BUI_hash h) { h_div = h; }
     void set_h_mod(BUI_hash h) { h_mod = h; }
     void test_add() const
@@ -617,9 +1208,138 @@ struct bigger_test_lcg
         BUI b = BUI_gen_lcg(b_seed,b_len,masks_for_mul);
         BUI c(a_len+b_len);
         u64arr_ll_mul(a.data(),a_len,b.data(),b_len,c.data());
+        while (c.size() > 1 and c.back() == 0) // hashes exclude leading zeros
+            c.pop_back();
         BUI_hash h(c);
         assert(h == h_mul);
     }
+    void test_mul_mt(unsigned threads) const
+    {
+        BUI a = BUI_gen_lcg(a_seed,a_len,masks_for_mul);
+        BUI b = BUI_gen_lcg(b_seed,b_len,masks_for_mul);
+        BUI c(a_len+b_len);
+        u64arr_ll_mul_mt(a.data(),a_len,b.data(),b_len,c.data(),threads);
+        while (c.size() > 1 and c.back() == 0) // hashes exclude leading zeros
+            c.pop_back();
+        BUI_hash h(c);
+        assert(h == h_mul);
+    }
+    // the scratch space is followed by guard limbs which must not change
+    void test_mul_scratch() const
+    {
+        BUI a = BUI_gen_lcg(a_seed,a_len,masks_for_mul);
+        BUI b = BUI_gen_lcg(b_seed,b_len,masks_for_mul);
+        BUI c(a_len+b_len);
+        size_t tl = u64arr_ll_mul_itch(a_len,b_len);
+        BUI t(tl+4,UMAX);
+        u64arr_ll_mul_scratch(a.data(),a_len,b.data(),b_len,c.data(),t.data());
+        for (size_t i = tl; i < tl+4; ++i)
+            assert(t[i] == UMAX);
+        while (c.size() > 1 and c.back() == 0) // hashes exclude leading zeros
+            c.pop_back();
+        BUI_hash h(c);
+        assert(h == h_mul);
+    }
+    void test_sqr() const
+    {
+        BUI a = BUI_gen_lcg(a_seed,a_len,masks_for_mul);
+        BUI c(2*a_len);
+        u64arr_ll_sqr(a.data(),a_len,c.data());
+        while (c.size() > 1 and c.back() == 0) // hashes exclude leading zeros
+            c.pop_back();
+        BUI_hash h(c);
+        assert(h == h_sqr);
+    }
+    void test_sqr_scratch() const
+    {
+        BUI a = BUI_gen_lcg(a_seed,a_len,masks_for_mul);
+        BUI c(2*a_len);
+        size_t tl = u64arr_ll_sqr_itch(a_len);
+        BUI t(tl+4,UMAX);
+        u64arr_ll_sqr_scratch(a.data(),a_len,c.data(),t.data());
+        for (size_t i = tl; i < tl+4; ++i)
+            assert(t[i] == UMAX);
+        while (c.size() > 1 and c.back() == 0) // hashes exclude leading zeros
+            c.pop_back();
+        BUI_hash h(c);
+        assert(h == h_sqr);
+    }
+    // compare with the low half from u64arr_ll_mul (requires a_len == b_len)
+    void test_mullo() const
+    {
+        BUI a = BUI_gen_lcg(a_seed,a_len,masks_for_mul);
+        BUI b = BUI_gen_lcg(b_seed,b_len,masks_for_mul);
+        BUI c(2*a_len), d(a_len);
+        u64arr_ll_mul(a.data(),a_len,b.data(),a_len,c.data());
+        u64arr_ll_mullo(a.data(),b.data(),a_len,d.data());
+        assert(std::equal(d.begin(),d.end(),c.begin()));
+        u64arr_ll_mullo(a.data(),a.data(),a_len,d.data());
+        u64arr_ll_sqr(a.data(),a_len,c.data());
+        assert(std::equal(d.begin(),d.end(),c.begin()));
+    }
+    // multiply and divide back exactly, also with low zero bits in b
+    void test_divexact() const
+    {
+        BUI a = BUI_gen_lcg(a_seed,a_len,masks_for_mul);
+        BUI b = BUI_gen_lcg(b_seed,b_len,masks_for_mul);
+        for (int k = 0; k < 2; ++k)
+        {
+            if (k)
+            {
+                b.insert(b.begin(),0);
+                b[1] = (b[1] | 2) & ~1uLL;
+            }
+            BUI c(a_len+b.size()), d(a_len+1);
+            u64arr_ll_mul(a.data(),a_len,b.data(),b.size(),c.data());
+            u64arr_ll_divexact(c.data(),c.size(),b.data(),b.size(),d.data());
+            assert(std::equal(a.begin(),a.end(),d.begin()));
+            assert(d[a_len] == 0);
+        }
+    }
+    // same as test_divexact with guard limbs after the scratch space
+    void test_divexact_scratch() const
+    {
+        BUI a = BUI_gen_lcg(a_seed,a_len,masks_for_mul);
+        BUI b = BUI_gen_lcg(b_seed,b_len,masks_for_mul);
+        for (int k = 0; k < 2; ++k)
+        {
+            if (k)
+            {
+                b.insert(b.begin(),0);
+                b[1] = (b[1] | 2) & ~1uLL;
+            }
+            BUI c(a_len+b.size()), d(a_len+1);
+            u64arr_ll_mul(a.data(),a_len,b.data(),b.size(),c.data());
+            size_t tl = u64arr_ll_divexact_itch(c.size(),b.size());
+            BUI t(tl+4,UMAX);
+            u64arr_ll_divexact_scratch(c.data(),c.size(),b.data(),b.size(),
+                                       d.data(),t.data());
+            for (size_t i = tl; i < tl+4; ++i)
+                assert(t[i] == UMAX);
+            assert(std::equal(a.begin(),a.end(),d.begin()));
+            assert(d[a_len] == 0);
+        }
+    }
+    // compare with the high half from u64arr_ll_mul (requires a_len == b_len)
+    void test_mulhi() const
+    {
+        BUI a = BUI_gen_lcg(a_seed,a_len,masks_for_mul);
+        BUI b = BUI_gen_lcg(b_seed,b_len,masks_for_mul);
+        BUI c(2*a_len), d(a_len), e(a_len);
+        u64arr_ll_mul(a.data(),a_len,b.data(),a_len,c.data());
+        u64arr_ll_mulhi(a.data(),b.data(),a_len,d.data());
+        // 0 <= exact - approximation < 2*a_len
+        bool o = u64arr_ll_sub(c.data()+a_len,a_len,d.data(),a_len,e.data());
+        assert(!o);
+        assert(e[0] < 2*a_len);
+        assert(std::all_of(e.begin()+1,e.end(),[](uint64_t v){return !v;}));
+        u64arr_ll_sqr(a.data(),a_len,c.data());
+        u64arr_ll_mulhi(a.data(),a.data(),a_len,d.data());
+        o = u64arr_ll_sub(c.data()+a_len,a_len,d.data(),a_len,e.data());
+        assert(!o);
+        assert(e[0] < 2*a_len);
+        assert(std::all_of(e.begin()+1,e.end(),[](uint64_t v){return !v;}));
+    }
     void test_div() const
     {
         BUI a = BUI_gen_lcg(a_seed,a_len,masks_for_mul);
@@ -627,6 +1347,8 @@ struct bigger_test_lcg
         BUI c(a_len-b_len+1);
         BUI d(b_len);
         u64arr_ll_div(a.data(),a_len,b.data(),b_len,c.data(),d.data());
+        while (c.size() > 1 and c.back() == 0) // hashes exclude leading zeros
+            c.pop_back();
         BUI_hash h(c);
         assert(h == h_div);
     }
@@ -637,6 +1359,23 @@ struct bigger_test_lcg
         BUI c(a_len-b_len+1);
         BUI d(b_len);
         u64arr_ll_div(a.data(),a_len,b.data(),b_len,c.data(),d.data());
+        while (d.size() > 1 and d.back() == 0) // hashes exclude leading zeros
+            d.pop_back();
+        BUI_hash h(d);
+        assert(h == h_mod);
+    }
+    // same remainder from a precomputed modulus
+    void test_mod_pre() const
+    {
+        BUI a = BUI_gen_lcg(a_seed,a_len,masks_for_mul);
+        BUI b = BUI_gen_lcg(b_seed,b_len,masks_for_mul);
+        BUI d(b_len);
+        u64arr_ll_modulus m;
+        u64arr_ll_modulus_init(&m,b.data(),b_len);
+        u64arr_ll_mod_pre(a.data(),a_len,&m,d.data());
+        u64arr_ll_modulus_free(&m);
+        while (d.size() > 1 and d.back() == 0) // hashes exclude leading zeros
+            d.pop_back();
         BUI_hash h(d);
         assert(h == h_mod);
     }
@@ -645,31 +1384,608 @@ struct bigger_test_lcg
 void test_u64arr_ll_add_to()
 {
     printf("test_u64arr_ll_add_to()\n");
+    BUI a = {5,7,0};
+    BUI b = {3,4};
+    bool ret = u64arr_ll_add_to(a.data(),3,b.data(),2);
+    assert(!ret);
+    assert(BUI_eq(a,{8,11,0}));
+    // carry between limbs of {n2,l2}
+    a = {UMAX,UMAX-1,9};
+    b = {1,1};
+    ret = u64arr_ll_add_to(a.data(),3,b.data(),2);
+    assert(!ret);
+    assert(BUI_eq(a,{0,0,10}));
+    // carry into the upper limbs of {n1,l1}
+    a = {UMAX,UMAX,UMAX,4};
+    b = {1};
+    ret = u64arr_ll_add_to(a.data(),4,b.data(),1);
+    assert(!ret);
+    assert(BUI_eq(a,{0,0,0,5}));
+    // carry past the top limb
+    a = {UMAX,UMAX,UMAX};
+    b = {2,UMAX};
+    ret = u64arr_ll_add_to(a.data(),3,b.data(),2);
+    assert(ret);
+    assert(BUI_eq(a,{1,UMAX,0}));
+    // equal lengths
+    a = {1uLL<<63,1uLL<<63};
+    b = {1uLL<<63,1uLL<<63};
+    ret = u64arr_ll_add_to(a.data(),2,b.data(),2);
+    assert(ret);
+    assert(BUI_eq(a,{0,1}));
 }
 
 void test_u64arr_ll_sub_from()
 {
     printf("test_u64arr_ll_sub_from()\n");
+    BUI a = {8,11,3};
+    BUI b = {3,4};
+    bool ret = u64arr_ll_sub_from(a.data(),3,b.data(),2);
+    assert(!ret);
+    assert(BUI_eq(a,{5,7,3}));
+    // subtract equal value
+    a = {UMAX,6};
+    b = {UMAX,6};
+    ret = u64arr_ll_sub_from(a.data(),2,b.data(),2);
+    assert(!ret);
+    assert(BUI_eq(a,{0,0}));
+    // borrow between limbs of {n2,l2}, none past it
+    a = {0,5,9};
+    b = {1,2};
+    ret = u64arr_ll_sub_from(a.data(),3,b.data(),2);
+    assert(!ret);
+    assert(BUI_eq(a,{UMAX,2,9}));
+    // underflow inside {n2,l2} with equal lengths
+    a = {3,5};
+    b = {4,5};
+    ret = u64arr_ll_sub_from(a.data(),2,b.data(),2);
+    assert(ret);
+    assert(BUI_eq(a,{UMAX,UMAX}));
+    // borrow carries into the upper limbs of {n1,l1}
+    a = {0,0,0,7};
+    b = {1};
+    ret = u64arr_ll_sub_from(a.data(),4,b.data(),1);
+    assert(!ret);
+    assert(BUI_eq(a,{UMAX,UMAX,UMAX,6}));
+    // underflow past the top limb
+    a = {2,3,0,0};
+    b = {3,3};
+    ret = u64arr_ll_sub_from(a.data(),4,b.data(),2);
+    assert(ret);
+    assert(BUI_eq(a,{UMAX,UMAX,UMAX,UMAX}));
 }
 
 void test_u64arr_ll_add()
 {
     printf("test_u64arr_ll_add()\n");
+    BUI a = {5,7};
+    BUI b = {3,4};
+    BUI c(2);
+    bool ret = u64arr_ll_add(a.data(),2,b.data(),2,c.data());
+    assert(!ret);
+    assert(BUI_eq(c,{8,11}));
+    ret = u64arr_ll_add(a.data(),0,b.data(),0,c.data());
+    assert(!ret);
+    // lx > ly with carry into the upper limbs of x
+    a = {UMAX,UMAX,UMAX,2};
+    b = {1};
+    c = BUI(4,UMAX);
+    ret = u64arr_ll_add(a.data(),4,b.data(),1,c.data());
+    assert(!ret);
+    assert(BUI_eq(c,{0,0,0,3}));
+    // lx < ly with carry into the upper limbs of y
+    c = BUI(4,UMAX);
+    ret = u64arr_ll_add(b.data(),1,a.data(),4,c.data());
+    assert(!ret);
+    assert(BUI_eq(c,{0,0,0,3}));
+    // carry past the top limb, both orders
+    a = {UMAX,UMAX,UMAX};
+    b = {0,1};
+    c = BUI(3,5);
+    ret = u64arr_ll_add(a.data(),3,b.data(),2,c.data());
+    assert(ret);
+    assert(BUI_eq(c,{UMAX,0,0}));
+    c = BUI(3,5);
+    ret = u64arr_ll_add(b.data(),2,a.data(),3,c.data());
+    assert(ret);
+    assert(BUI_eq(c,{UMAX,0,0}));
+    // carry absorbed by the longer operand
+    a = {UMAX,1,7};
+    b = {UMAX,UMAX};
+    c = BUI(3);
+    ret = u64arr_ll_add(a.data(),3,b.data(),2,c.data());
+    assert(!ret);
+    assert(BUI_eq(c,{UMAX-1,1,8}));
 }
 
 void test_u64arr_ll_sub()
 {
     printf("test_u64arr_ll_sub()\n");
+    BUI a = {8,11};
+    BUI b = {3,4};
+    BUI c(2);
+    bool ret = u64arr_ll_sub(a.data(),2,b.data(),2,c.data());
+    assert(!ret);
+    assert(BUI_eq(c,{5,7}));
+    // underflow inside the common limbs
+    ret = u64arr_ll_sub(b.data(),2,a.data(),2,c.data());
+    assert(ret);
+    assert(BUI_eq(c,{UMAX-4,UMAX-7}));
+    // lx > ly, borrow carries into the upper limbs of x
+    a = {0,0,0,7};
+    b = {1};
+    c = BUI(4,5);
+    ret = u64arr_ll_sub(a.data(),4,b.data(),1,c.data());
+    assert(!ret);
+    assert(BUI_eq(c,{UMAX,UMAX,UMAX,6}));
+    // lx > ly, no borrow leaves the upper limbs of x
+    a = {9,0,3};
+    b = {4};
+    c = BUI(3,5);
+    ret = u64arr_ll_sub(a.data(),3,b.data(),1,c.data());
+    assert(!ret);
+    assert(BUI_eq(c,{5,0,3}));
+    // lx > ly, underflow past the top limb
+    a = {2,3,0,0};
+    b = {3,3};
+    c = BUI(4,5);
+    ret = u64arr_ll_sub(a.data(),4,b.data(),2,c.data());
+    assert(ret);
+    assert(BUI_eq(c,{UMAX,UMAX,UMAX,UMAX}));
+    // lx < ly, upper limbs of y are zero and no borrow
+    a = {9,4};
+    b = {4,4,0,0};
+    c = BUI(4,5);
+    ret = u64arr_ll_sub(a.data(),2,b.data(),4,c.data());
+    assert(!ret);
+    assert(BUI_eq(c,{5,0,0,0}));
+    // lx < ly, upper limbs of y are zero but a borrow leaves x
+    a = {3,4};
+    b = {4,4,0,0};
+    c = BUI(4,5);
+    ret = u64arr_ll_sub(a.data(),2,b.data(),4,c.data());
+    assert(ret);
+    assert(BUI_eq(c,{UMAX,UMAX,UMAX,UMAX}));
+    // lx < ly, nonzero upper limbs of y
+    a = {9};
+    b = {4,0,1};
+    c = BUI(3,5);
+    ret = u64arr_ll_sub(a.data(),1,b.data(),3,c.data());
+    assert(ret);
+    assert(BUI_eq(c,{5,0,UMAX}));
+    a = {3};
+    c = BUI(3,5);
+    ret = u64arr_ll_sub(a.data(),1,b.data(),3,c.data());
+    assert(ret);
+    assert(BUI_eq(c,{UMAX,UMAX,UMAX-1}));
 }
 
 void test_u64arr_ll_mul()
 {
     printf("test_u64arr_ll_mul()\n");
+    BUI a = {UMAX,UMAX,UMAX};
+    BUI b = {UMAX,UMAX};
+    BUI c(5);
+    u64arr_ll_mul(a.data(),3,b.data(),2,c.data());
+    assert(BUI_eq(c,{1,0,UMAX,UMAX-1,UMAX}));
+    a = {14996889397075187173uLL,16224389114002008162uLL,29004uLL};
+    b = {12157665459056928801uLL,32};
+    c = BUI(5,UMAX);
+    u64arr_ll_mul(a.data(),3,b.data(),2,c.data());
+    assert(BUI_eq(c,{11171155003722324613uLL,14485401215066016158uLL,
+                     6333860648543719009uLL,947272uLL}));
+    // sizes chosen to use the karatsuba and unbalanced algorithms
+    bigger_test_lcg t1(5,11,100,100);
+    t1.set_h_mul(BUI_hash(14491323512247010065uLL,5667973400295290467uLL,
+        2252935714474443275uLL,4415706988589307595uLL,
+        17906224475215001250uLL));
+    t1.test_mul();
+    bigger_test_lcg t2(7,13,500,300);
+    t2.set_h_mul(BUI_hash(11389100942917438858uLL,13746419946996658822uLL,
+        1273591096471591112uLL,7319476363560210615uLL,
+        14187761763822363721uLL));
+    t2.test_mul();
+    bigger_test_lcg t3(17,19,1000,20);
+    t3.set_h_mul(BUI_hash(5039712132693187304uLL,12071183166565297618uLL,
+        1470300488291738988uLL,738047371810055769uLL,569487870439111259uLL));
+    t3.test_mul();
+    bigger_test_lcg t4(23,29,2000,700);
+    t4.set_h_mul(BUI_hash(9369044139665627005uLL,11580114123425188479uLL,
+        288140462839419211uLL,6744208467128769160uLL,2108674819083254878uLL));
+    t4.test_mul();
+    // sizes above the karatsuba threshold
+    bigger_test_lcg t5(31,37,90,80);
+    t5.set_h_mul(BUI_hash(12532856880504128822uLL,11716046853922661238uLL,
+        1466932572152192141uLL,1737275586161311601uLL,
+        11758190697923218391uLL));
+    t5.test_mul();
+    bigger_test_lcg t6(41,43,400,400);
+    t6.set_h_mul(BUI_hash(9954221103827171281uLL,2104884572690787497uLL,
+        1193985465020890210uLL,11726604969083367881uLL,88702000514679562uLL));
+    t6.test_mul();
+    // sizes in the toom-3 and toom-4 ranges
+    bigger_test_lcg t14(109,113,700,650);
+    t14.set_h_mul(BUI_hash(13862669836777171165uLL,17949178269272584315uLL,
+        1806279702769037424uLL,1094744322286636772uLL,
+        17014860662386990332uLL));
+    t14.test_mul();
+    bigger_test_lcg t10(73,79,1000,900);
+    t10.set_h_mul(BUI_hash(9028518244986962158uLL,15932712137139169442uLL,
+        1151578589856749173uLL,6420988941089506300uLL,1967204807668701768uLL));
+    t10.test_mul();
+    bigger_test_lcg t15(127,131,1150,1100);
+    t15.set_h_mul(BUI_hash(1271513689374391408uLL,7650852494553949716uLL,
+        784789500716639254uLL,3585696695785810788uLL,6090043993728434858uLL));
+    t15.test_mul();
+    // sizes chosen to use the floating point FFT
+    bigger_test_lcg t7(47,53,1500,1400);
+    t7.set_h_mul(BUI_hash(11896081156813534618uLL,76059564824598442uLL,
+        134231864684181630uLL,5224866441301817629uLL,5047846000977708730uLL));
+    t7.test_mul();
+    bigger_test_lcg t8(59,61,3000,2500);
+    t8.set_h_mul(BUI_hash(14272462304400909666uLL,6648276420523714186uLL,
+        1690907909739647587uLL,16381454367282800247uLL,728196664614389292uLL));
+    t8.test_mul();
+    bigger_test_lcg t9(67,71,20000,15000);
+    t9.set_h_mul(BUI_hash(5297420822398875458uLL,12911133584908852470uLL,
+        1945945976009876165uLL,16182922849912678404uLL,
+        5936250920276529687uLL));
+    t9.test_mul();
+    // sizes chosen to use the number theoretic transform
+    bigger_test_lcg t11(83,89,40000,30000);
+    t11.set_h_mul(BUI_hash(1867674790897199575uLL,12056224504258606287uLL,
+        44782848308900950uLL,360830358968743118uLL,18299454664963676714uLL));
+    t11.test_mul();
+    // long operand sliced into pieces the length of the short one
+    bigger_test_lcg t12(97,101,50000,300);
+    t12.set_h_mul(BUI_hash(17457394235468614689uLL,13010405854112520247uLL,
+        28045522770692059uLL,1144398668996539277uLL,17705207798644712839uLL));
+    t12.test_mul();
+    bigger_test_lcg t13(103,107,3050,100);
+    t13.set_h_mul(BUI_hash(12940305455870728255uLL,13118198603819982257uLL,
+        2182999108556011255uLL,12286678955360061171uLL,
+        1665521149804382138uLL));
+    t13.test_mul();
+    // the parallel version should give the same results
+    for (unsigned threads = 1; threads <= 4; ++threads)
+    {
+        t1.test_mul_mt(threads);
+        t4.test_mul_mt(threads);
+        t8.test_mul_mt(threads);
+        t11.test_mul_mt(threads);
+        t12.test_mul_mt(threads);
+        t13.test_mul_mt(threads);
+    }
+    t9.test_mul_mt(7);
+    // caller provided scratch space
+    t1.test_mul_scratch();
+    t3.test_mul_scratch();
+    t5.test_mul_scratch();
+    t6.test_mul_scratch();
+    t8.test_mul_scratch();
+    t11.test_mul_scratch();
+    t12.test_mul_scratch();
+}
+
+void test_u64arr_ll_sqr()
+{
+    printf("test_u64arr_ll_sqr()\n");
+    BUI a = {UMAX,UMAX,UMAX};
+    BUI c(6);
+    u64arr_ll_sqr(a.data(),3,c.data());
+    assert(BUI_eq(c,{1,0,0,UMAX-1,UMAX,UMAX}));
+    // u64arr_ll_mul should square when both inputs are the same
+    c = BUI(6,0);
+    u64arr_ll_mul(a.data(),3,a.data(),3,c.data());
+    assert(BUI_eq(c,{1,0,0,UMAX-1,UMAX,UMAX}));
+    // sizes chosen to use each squaring algorithm (only a is used)
+    bigger_test_lcg t1(3,0,30,0);
+    t1.set_h_sqr(BUI_hash(16577479498273004990uLL,3178262704884299236uLL,
+        1349080116981006954uLL,13166342738745695733uLL,
+        8612817429926158487uLL));
+    t1.test_sqr();
+    bigger_test_lcg t2(5,0,60,0);
+    t2.set_h_sqr(BUI_hash(4346254495417561613uLL,13434710476592512457uLL,
+        2174588158977089333uLL,16273542243720073411uLL,
+        12274172205048338862uLL));
+    t2.test_sqr();
+    bigger_test_lcg t3(7,0,100,0);
+    t3.set_h_sqr(BUI_hash(10796843934671676803uLL,3722150489848572681uLL,
+        1771516399345503214uLL,4948843771375843269uLL,
+        14715255850788339834uLL));
+    t3.test_sqr();
+    bigger_test_lcg t4(11,0,200,0);
+    t4.set_h_sqr(BUI_hash(6736680741275244817uLL,5909333139742929053uLL,
+        219295276561143991uLL,2872026358957710661uLL,
+        14827686321996479994uLL));
+    t4.test_sqr();
+    bigger_test_lcg t5(13,0,3000,0);
+    t5.set_h_sqr(BUI_hash(3826554549853829027uLL,11198468421896212313uLL,
+        1961035319164313739uLL,14679661043414648054uLL,
+        4959058755542233516uLL));
+    t5.test_sqr();
+    bigger_test_lcg t6(17,0,40000,0);
+    t6.set_h_sqr(BUI_hash(1792293359943916536uLL,3979524340779350528uLL,
+        1498410217346462660uLL,4693581847355572853uLL,
+        4673513503847688167uLL));
+    t6.test_sqr();
+    bigger_test_lcg t7(19,0,1200,0);
+    t7.set_h_sqr(BUI_hash(13756257836358389403uLL,9415760365525289847uLL,
+        182739034763881874uLL,10607479954378613090uLL,
+        10233427412432439889uLL));
+    t7.test_sqr();
+    bigger_test_lcg t8(23,0,700,0);
+    t8.set_h_sqr(BUI_hash(2706497221995988986uLL,17760292716588015794uLL,
+        1084498496334935561uLL,1211991568944644965uLL,
+        2681694158453595041uLL));
+    t8.test_sqr();
+    // caller provided scratch space
+    t1.test_sqr_scratch();
+    t2.test_sqr_scratch();
+    t3.test_sqr_scratch();
+    t4.test_sqr_scratch();
+    t5.test_sqr_scratch();
+    t6.test_sqr_scratch();
+    t7.test_sqr_scratch();
+}
+
+void test_u64arr_ll_mullo()
+{
+    printf("test_u64arr_ll_mullo()\n");
+    BUI a = {UMAX,UMAX,UMAX};
+    BUI c(3);
+    u64arr_ll_mullo(a.data(),a.data(),3,c.data());
+    assert(BUI_eq(c,{1,0,0}));
+    a = {14996889397075187173uLL,16224389114002008162uLL};
+    BUI b = {12157665459056928801uLL,32};
+    c = BUI(2);
+    u64arr_ll_mullo(a.data(),b.data(),2,c.data());
+    assert(BUI_eq(c,{11171155003722324613uLL,14485401215066016158uLL}));
+    // sizes chosen to use rows, the recursion and a full FFT product
+    bigger_test_lcg t1(3,5,100,100);
+    t1.test_mullo();
+    bigger_test_lcg t2(7,11,500,500);
+    t2.test_mullo();
+    bigger_test_lcg t3(13,17,2000,2000);
+    t3.test_mullo();
+}
+
+void test_u64arr_ll_mulhi()
+{
+    printf("test_u64arr_ll_mulhi()\n");
+    BUI a = {UMAX};
+    BUI c(1);
+    u64arr_ll_mulhi(a.data(),a.data(),1,c.data());
+    assert(BUI_eq(c,{UMAX-1}));
+    // sizes chosen to use rows, the recursion and a full FFT product
+    bigger_test_lcg t1(3,5,100,100);
+    t1.test_mulhi();
+    bigger_test_lcg t2(7,11,500,500);
+    t2.test_mulhi();
+    bigger_test_lcg t3(13,17,2000,2000);
+    t3.test_mulhi();
+}
+
+void test_u64arr_ll_divexact_64()
+{
+    printf("test_u64arr_ll_divexact_64()\n");
+    BUI a = {0,1};
+    u64arr_ll_divexact_64(a.data(),2,2);
+    assert(BUI_eq(a,{1uLL<<63,0}));
+    BUI primes100 = {2,3,5,7,11,13,17,19,23,29,31,37,41,43,47,
+                     53,59,61,67,71,73,79,83,89,97};
+    a = {14005151959471558694uLL,124985089766135611uLL};
+    for (uint64_t p : primes100)
+        u64arr_ll_divexact_64(a.data(),a.size(),p);
+    assert(BUI_eq(a,{1,0}));
+    a = {14005151959471558694uLL,124985089766135611uLL};
+    u64arr_ll_divexact_64(a.data(),2,304250263527210uLL); // 2*3*...*41
+    assert(BUI_eq(a,{14701707006458924807uLL,410}));
+    // multiply and divide back
+    BUI divisors = {1,3,10,1uLL<<32,1000000000000037uLL,1uLL<<63,UMAX};
+    for (uint64_t d : divisors)
+    {
+        BUI n = BUI_gen_lcg(d,50,masks_for_mul);
+        BUI m = n;
+        m.push_back(u64arr_ll_mul_64(m.data(),50,d));
+        u64arr_ll_divexact_64(m.data(),51,d);
+        assert(m.back() == 0);
+        m.pop_back();
+        assert(BUI_eq(m,n));
+    }
+}
+
+void test_u64arr_ll_divexact()
+{
+    printf("test_u64arr_ll_divexact()\n");
+    BUI a = {UMAX,UMAX};
+    BUI b = {UMAX};
+    BUI q(2);
+    u64arr_ll_divexact(a.data(),2,b.data(),1,q.data());
+    assert(BUI_eq(q,{1,1}));
+    a = {0,0,UMAX-1,1};
+    b = {0,2};
+    q = BUI(3);
+    u64arr_ll_divexact(a.data(),4,b.data(),2,q.data());
+    assert(BUI_eq(q,{0,UMAX,0}));
+    // sizes chosen to use rows, divide and conquer and a newton inverse
+    bigger_test_lcg t1(3,5,100,40);
+    t1.test_divexact();
+    bigger_test_lcg t2(7,11,40,100);
+    t2.test_divexact();
+    bigger_test_lcg t3(13,17,700,700);
+    t3.test_divexact();
+    bigger_test_lcg t4(19,23,2000,300);
+    t4.test_divexact();
+    bigger_test_lcg t5(29,31,4500,2100);
+    t5.test_divexact();
+    // caller provided scratch space
+    t1.test_divexact_scratch();
+    t2.test_divexact_scratch();
+    t3.test_divexact_scratch();
+    t4.test_divexact_scratch();
+    t5.test_divexact_scratch();
 }
 
 void test_u64arr_ll_div()
 {
     printf("test_u64arr_ll_div()\n");
+    BUI a = {11171155003722324613uLL,14485401215066016158uLL,
+             6333860648543719009uLL,947272uLL};
+    BUI b = {12157665459056928801uLL,32};
+    BUI q(3), r(2);
+    u64arr_ll_div(a.data(),4,b.data(),2,q.data(),r.data());
+    assert(BUI_eq(q,{14996889397075187173uLL,16224389114002008162uLL,
+                     29004uLL}));
+    assert(BUI_eq(r,{0,0}));
+    a = {UMAX,UMAX,UMAX};
+    b = {UMAX,UMAX,UMAX};
+    q = BUI(1);
+    r = BUI(3);
+    u64arr_ll_div(a.data(),3,b.data(),3,q.data(),r.data());
+    assert(BUI_eq(q,{1}));
+    assert(BUI_eq(r,{0,0,0}));
+    a = {3,UMAX};
+    b = {7};
+    q = BUI(2);
+    r = BUI(1);
+    u64arr_ll_div(a.data(),2,b.data(),1,q.data(),r.data());
+    assert(BUI_eq(q,{2635249153387078802uLL,2635249153387078802uLL}));
+    assert(BUI_eq(r,{5}));
+    // quotient limb estimates which are 1 too large after correction
+    a = {UMAX,1uLL<<63,(1uLL<<63)-1,1uLL<<63,1uLL<<63};
+    b = {1uLL<<63,1uLL<<63,1uLL<<63};
+    q = BUI(3);
+    r = BUI(3);
+    u64arr_ll_div(a.data(),5,b.data(),3,q.data(),r.data());
+    assert(BUI_eq(q,{UMAX,UMAX,0}));
+    assert(BUI_eq(r,{(1uLL<<63)-1,1,1uLL<<63}));
+    a = {UMAX,1uLL<<63,1uLL<<63,0,UMAX-1};
+    b = {(1uLL<<63)-1,1,UMAX-1};
+    u64arr_ll_div(a.data(),5,b.data(),3,q.data(),r.data());
+    assert(BUI_eq(q,{UMAX-1,UMAX,0}));
+    assert(BUI_eq(r,{UMAX-2,(1uLL<<63)+3,UMAX-2}));
+    // the same when normalization needs a shift
+    a = {(1uLL<<62)-1,UMAX-1,(1uLL<<63)-1};
+    b = {(1uLL<<62)-1,UMAX,(1uLL<<62)-1};
+    q = BUI(1);
+    u64arr_ll_div(a.data(),3,b.data(),3,q.data(),r.data());
+    assert(BUI_eq(q,{1}));
+    assert(BUI_eq(r,{0,UMAX,(1uLL<<62)-1}));
+    bigger_test_lcg t1(5,7,100,40);
+    t1.set_h_div(BUI_hash(6508342068154921643uLL,14868381800318395767uLL,
+        1487940076971676308uLL,2074732726136479635uLL,
+        14468517128465574534uLL));
+    t1.set_h_mod(BUI_hash(10491223384885382880uLL,3092029384551264440uLL,
+        32555620515491856uLL,12370085553964057918uLL,
+        12765568796591828019uLL));
+    t1.test_div();
+    t1.test_mod();
+    t1.test_mod_pre();
+    bigger_test_lcg t2(11,13,1000,300);
+    t2.set_h_div(BUI_hash(1225387106999957346uLL,9088642744618646124uLL,
+        970307005027413803uLL,17147598908395862414uLL,
+        16599890581703290302uLL));
+    t2.set_h_mod(BUI_hash(13719794631724934855uLL,1179051339984412757uLL,
+        283344488505385139uLL,8091346507202655264uLL,4723743755218290866uLL));
+    t2.test_div();
+    t2.test_mod();
+    t2.test_mod_pre();
+    bigger_test_lcg t3(17,19,50,1);
+    t3.set_h_div(BUI_hash(5908986664462280603uLL,16376726284857099103uLL,
+        201325848383422383uLL,11402345795346954181uLL,
+        8632536813698536273uLL));
+    t3.set_h_mod(BUI_hash(51));
+    t3.test_div();
+    t3.test_mod();
+    t3.test_mod_pre();
+    bigger_test_lcg t4(23,29,2000,1999);
+    t4.set_h_div(BUI_hash(957038082072947458uLL));
+    t4.set_h_mod(BUI_hash(12501031022838742794uLL,17783883746351652278uLL,
+        1490258182871406112uLL,11360889302856218417uLL,
+        7417615173648554126uLL));
+    t4.test_div();
+    t4.test_mod();
+    t4.test_mod_pre();
+    bigger_test_lcg t5(31,37,700,2);
+    t5.set_h_div(BUI_hash(10164280587352020371uLL,4834714646423232171uLL,
+        796827204481657222uLL,7882800650669554999uLL,
+        12852081193059868456uLL));
+    t5.set_h_mod(BUI_hash(4817249057598673140uLL,4400625409731915464uLL,
+        1663753563474780360uLL,160872474754830858uLL,
+        1948767185276215717uLL));
+    t5.test_div();
+    t5.test_mod();
+    t5.test_mod_pre();
+    bigger_test_lcg t6(41,43,64,64);
+    t6.set_h_div(BUI_hash(99));
+    t6.set_h_mod(BUI_hash(413264394632581756uLL,4270517610570245790uLL,
+        376456009185465922uLL,16702524912543822506uLL,
+        13777409815885005444uLL));
+    t6.test_div();
+    t6.test_mod();
+    t6.test_mod_pre();
+    bigger_test_lcg t7(59,61,3000,1500);
+    t7.set_h_div(BUI_hash(326946974110614750uLL,3937921147662633918uLL,
+        338377516531615773uLL,3673515746857913801uLL,
+        6081679094650706909uLL));
+    t7.set_h_mod(BUI_hash(15938906513358682435uLL,2007147829951590239uLL,
+        1956795466916368434uLL,436468287233658308uLL,
+        5457812210792478642uLL));
+    t7.test_div();
+    t7.test_mod();
+    t7.test_mod_pre();
+    bigger_test_lcg t8(47,53,14000,4100);
+    t8.set_h_div(BUI_hash(8964847582341100892uLL,5482750679915521196uLL,
+        731119479492136326uLL,1451886667676218132uLL,
+        7290548937597392002uLL));
+    t8.set_h_mod(BUI_hash(11498355818615975290uLL,11524454196457401084uLL,
+        271169948566459622uLL,2734940533415414672uLL,
+        831092533010475703uLL));
+    t8.test_div();
+    t8.test_mod();
+    t8.test_mod_pre();
+}
+
+void test_u64arr_ll_mod_pre()
+{
+    printf("test_u64arr_ll_mod_pre()\n");
+    u64arr_ll_modulus m;
+    BUI a = {11171155003722324613uLL,14485401215066016158uLL,
+             6333860648543719009uLL,947272uLL};
+    BUI b = {12157665459056928801uLL,32};
+    BUI r(2);
+    u64arr_ll_modulus_init(&m,b.data(),2);
+    u64arr_ll_mod_pre(a.data(),4,&m,r.data());
+    assert(BUI_eq(r,{0,0}));
+    // shorter than the modulus, and the same modulus again
+    a = {5};
+    u64arr_ll_mod_pre(a.data(),1,&m,r.data());
+    assert(BUI_eq(r,{5,0}));
+    a = {12157665459056928801uLL,32};
+    u64arr_ll_mod_pre(a.data(),2,&m,r.data());
+    assert(BUI_eq(r,{0,0}));
+    u64arr_ll_modulus_free(&m);
+    a = {3,UMAX};
+    b = {7};
+    r = BUI(1);
+    u64arr_ll_modulus_init(&m,b.data(),1);
+    u64arr_ll_mod_pre(a.data(),2,&m,r.data());
+    assert(BUI_eq(r,{5}));
+    u64arr_ll_modulus_free(&m);
+    a = {UMAX,1uLL<<63,(1uLL<<63)-1,1uLL<<63,1uLL<<63};
+    b = {1uLL<<63,1uLL<<63,1uLL<<63};
+    r = BUI(3);
+    u64arr_ll_modulus_init(&m,b.data(),3);
+    u64arr_ll_mod_pre(a.data(),5,&m,r.data());
+    assert(BUI_eq(r,{(1uLL<<63)-1,1,1uLL<<63}));
+    u64arr_ll_modulus_free(&m);
+    a = {(1uLL<<62)-1,UMAX-1,(1uLL<<63)-1};
+    b = {(1uLL<<62)-1,UMAX,(1uLL<<62)-1};
+    u64arr_ll_modulus_init(&m,b.data(),3);
+    u64arr_ll_mod_pre(a.data(),3,&m,r.data());
+    assert(BUI_eq(r,{0,UMAX,(1uLL<<62)-1}));
+    u64arr_ll_modulus_free(&m);
 }
 
 int main(int argc, const char **argv)
@@ -682,15 +1998,35 @@ int main(int argc, const char **argv)
     test_u64arr_ll_sub_64();
     test_u64arr_ll_mul_32();
     test_u64arr_ll_mul_64();
+    test_u64arr_ll_addmul_64();
+    test_u64arr_ll_submul_64();
+    test_u64arr_ll_addmul_2();
     test_u64arr_ll_div_32();
     test_u64arr_ll_div_64();
+    test_u64arr_ll_div_64_pre();
+    test_u64arr_ll_mod_64();
+    test_u64arr_ll_div_const();
     test_u64arr_ll_write_str();
+    test_u64arr_ll_write_str_dc();
     test_u64arr_ll_read_str();
-    //test_u64arr_ll_add_to();
-    //test_u64arr_ll_sub_from();
-    //test_u64arr_ll_add();
-    //test_u64arr_ll_sub();
-    //test_u64arr_ll_mul();
-    //test_u64arr_ll_div();
+    test_u64arr_ll_read_str_dc();
+    test_u64arr_ll_str_pow2();
+    test_u64arr_ll_str_chunks();
+    test_u64arr_ll_read_str_invalid();
+    test_u64arr_ll_str_stream();
+    test_u64arr_ll_str_fd();
+    test_u64arr_ll_str_cache();
+    test_u64arr_ll_add_to();
+    test_u64arr_ll_sub_from();
+    test_u64arr_ll_add();
+    test_u64arr_ll_sub();
+    test_u64arr_ll_mul();
+    test_u64arr_ll_sqr();
+    test_u64arr_ll_mullo();
+    test_u64arr_ll_mulhi();
+    test_u64arr_ll_divexact_64();
+    test_u64arr_ll_divexact();
+    test_u64arr_ll_div();
+    test_u64arr_ll_mod_pre();
     return 0;
 }
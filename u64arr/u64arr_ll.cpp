@@ -1,6 +1,22 @@
 #include "u64arr_ll.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
 
 #include "../utils/u64ops.h"
 
@@ -73,8 +89,58 @@ uint64_t u64arr_ll_mul_64(uint64_t *n, size_t l, uint64_t a)
     return c;
 }
 
+// minimum length to divide using a precomputed reciprocal
+// below this, the divq to compute the reciprocal is not paid back
+#ifndef U64ARR_LL_DIV_64_PRE_THRESHOLD
+#define U64ARR_LL_DIV_64_PRE_THRESHOLD 4
+#endif
+
+// minimum length to convert to string by divide and conquer, below this
+// digits are peeled off one at a time from the least significant
+#ifndef U64ARR_LL_WRITE_STR_DC_THRESHOLD
+#define U64ARR_LL_WRITE_STR_DC_THRESHOLD 20
+#endif
+
+// minimum length to convert the quotient and remainder of a divide and
+// conquer string conversion step in parallel
+#ifndef U64ARR_LL_WRITE_STR_MT_THRESHOLD
+#define U64ARR_LL_WRITE_STR_MT_THRESHOLD 2000
+#endif
+
+// minimum length (in limbs of digits) to parse a string by divide and
+// conquer, below this chunks of digits are added one at a time
+#ifndef U64ARR_LL_READ_STR_DC_THRESHOLD
+#define U64ARR_LL_READ_STR_DC_THRESHOLD 50
+#endif
+
+static_assert(U64ARR_LL_WRITE_STR_DC_THRESHOLD >= 2);
+static_assert(U64ARR_LL_READ_STR_DC_THRESHOLD >= 2);
+
+// default limit for the total size of powers of the base cached by string
+// conversions (in limbs)
+#ifndef U64ARR_LL_STR_CACHE_LIMBS
+#define U64ARR_LL_STR_CACHE_LIMBS (1uLL << 22)
+#endif
+
+// size of the buffers for reading and writing strings with file descriptors
+#ifndef U64ARR_LL_STR_IO_BLOCK
+#define U64ARR_LL_STR_IO_BLOCK 65536
+#endif
+
+// minimum length to compute mod 64 bit integer by folding limbs with
+// precomputed powers of 2^64 instead of the division loop
+#ifndef U64ARR_LL_MOD_64_FOLD_THRESHOLD
+#define U64ARR_LL_MOD_64_FOLD_THRESHOLD 16
+#endif
+
 uint32_t u64arr_ll_div_32(uint64_t *n, size_t l, uint32_t a)
 {
+    if (l >= U64ARR_LL_DIV_64_PRE_THRESHOLD)
+    {
+        u64arr_ll_divisor_64 dv;
+        u64arr_ll_divisor_64_init(&dv,a);
+        return u64arr_ll_div_64_pre(n,l,&dv);
+    }
     uint32_t *nn = (uint32_t*)n;
     uint64_t v = 0;
     for (size_t i = 2*l; i--;)
@@ -88,6 +154,12 @@ uint32_t u64arr_ll_div_32(uint64_t *n, size_t l, uint32_t a)
 
 uint64_t u64arr_ll_div_64(uint64_t *n, size_t l, uint64_t a)
 {
+    if (l >= U64ARR_LL_DIV_64_PRE_THRESHOLD)
+    {
+        u64arr_ll_divisor_64 dv;
+        u64arr_ll_divisor_64_init(&dv,a);
+        return u64arr_ll_div_64_pre(n,l,&dv);
+    }
     uint64_t v0 = 0, v1;
     for (size_t i = l; i--;)
     {
@@ -98,67 +170,575 @@ uint64_t u64arr_ll_div_64(uint64_t *n, size_t l, uint64_t a)
     return v0;
 }
 
+void u64arr_ll_divexact_64(uint64_t *n, size_t l, uint64_t a)
+{
+    assert(a);
+    // divide by the power of 2 in a by shifting limbs as they are read
+    unsigned s = __builtin_ctzll(a);
+    a >>= s;
+    uint64_t inv = _binvert64(a), c = 0, u;
+    bool b;
+    for (size_t i = 0; i < l; ++i)
+    {
+        u = n[i] >> s;
+        if (s and i+1 < l)
+            u |= n[i+1] << (64-s);
+        // the quotient limb makes the low limb 0 after subtracting
+        b = u < c;
+        u = (u - c) * inv;
+        n[i] = u;
+        c = _mul64hi(u,a) + b;
+    }
+}
+
+void u64arr_ll_divisor_64_init(u64arr_ll_divisor_64 *dv, uint64_t a)
+{
+    assert(a);
+    dv->s = __builtin_clzll(a);
+    dv->d = a << dv->s;
+    dv->v = _udiv64_reciprocal(dv->d);
+}
+
+uint64_t u64arr_ll_div_64_pre(uint64_t *n, size_t l,
+                              const u64arr_ll_divisor_64 *dv)
+{
+    uint64_t d = dv->d, v = dv->v, r = 0;
+    unsigned s = dv->s;
+    if (!l)
+        return 0;
+    if (s == 0)
+    {
+        for (size_t i = l; i--;)
+            _udiv64_pre(n[i],r,d,v,n+i,&r);
+        return r;
+    }
+    // divide {n,l}*2^s by d*2^s, shifting limbs as they are read
+    // the extra top limb is below 2^s <= d so its quotient limb is 0
+    r = n[l-1] >> (64-s);
+    for (size_t i = l-1; i; --i)
+        _udiv64_pre((n[i] << s) | (n[i-1] >> (64-s)),r,d,v,n+i,&r);
+    _udiv64_pre(n[0] << s,r,d,v,n,&r);
+    return r >> s;
+}
+
+uint64_t u64arr_ll_mod_64_pre(const uint64_t *n, size_t l,
+                              const u64arr_ll_divisor_64 *dv)
+{
+    uint64_t d = dv->d, v = dv->v, r = 0;
+    unsigned s = dv->s;
+    if (!l)
+        return 0;
+    if (s == 0)
+    {
+        for (size_t i = l; i--;)
+            _udiv64_pre(n[i],r,d,v,nullptr,&r);
+        return r;
+    }
+    r = n[l-1] >> (64-s);
+    for (size_t i = l-1; i; --i)
+        _udiv64_pre((n[i] << s) | (n[i-1] >> (64-s)),r,d,v,nullptr,&r);
+    _udiv64_pre(n[0] << s,r,d,v,nullptr,&r);
+    return r >> s;
+}
+
+uint64_t u64arr_ll_mod_64(const uint64_t *n, size_t l, uint64_t a)
+{
+    u64arr_ll_divisor_64 dv;
+    u64arr_ll_divisor_64_init(&dv,a);
+    if (l < U64ARR_LL_MOD_64_FOLD_THRESHOLD)
+        return u64arr_ll_mod_64_pre(n,l,&dv);
+    // c[k] = B^k mod a for k = 1..6, computed as multiples of 2^s mod the
+    // normalized divisor
+    uint64_t c[7], p = 1uLL << dv.s;
+    for (size_t k = 1; k < 7; ++k)
+    {
+        _udiv64_pre(0,p,dv.d,dv.v,nullptr,&p);
+        c[k] = p >> dv.s;
+    }
+    // the top limbs which do not fill a group of 4 start the sum
+    size_t i = l - l % 4;
+    __uint128_t r = u64arr_ll_mod_64_pre(n+i,l%4,&dv);
+    uint64_t r2 = 0;
+    // {r,r2} (3 limbs) is congruent to the limbs above i, each step replaces
+    // it with n[i] + n[i+1]*c[1] + n[i+2]*c[2] + n[i+3]*c[3] + (the limbs of
+    // {r,r2} times c[4], c[5], c[6]), all products are < a*B so the sum is
+    // < 6*B^2 and r2 stays below 6
+    while (i)
+    {
+        i -= 4;
+        __uint128_t t[6] = {(__uint128_t)n[i+1] * c[1],
+                            (__uint128_t)n[i+2] * c[2],
+                            (__uint128_t)n[i+3] * c[3],
+                            (__uint128_t)(uint64_t)r * c[4],
+                            (__uint128_t)(uint64_t)(r >> 64) * c[5],
+                            (__uint128_t)r2 * c[6]};
+        r = n[i];
+        r2 = 0;
+        for (size_t k = 0; k < 6; ++k)
+        {
+            r += t[k];
+            r2 += r < t[k];
+        }
+    }
+    uint64_t m[3] = {(uint64_t)r,(uint64_t)(r >> 64),r2};
+    return u64arr_ll_mod_64_pre(m,3,&dv);
+}
+
 // digits for bases 2-36
 const char *_digits1 = "0123456789abcdefghijklmnopqrstuvwxyz";
 const char *_digits2 = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
 
-// convert digit to numereic value
+// convert digit to numereic value, 255 for characters which are not digits
+// (letters are case folded by setting bit 5, both values are computed so it
+// compiles to a conditional move rather than a branch on the digit)
 static inline uint8_t _digitval(char c)
 {
-    return c <= '9' ? c-'0' : (c >= 'a' ? c-'a'+10 : c-'A'+10);
+    uint8_t d = c - '0', a = (c | 0x20) - 'a';
+    return d <= 9 ? d : (a < 26 ? a+10 : 255);
 }
 
-size_t u64arr_ll_write_str(uint8_t base, bool uppercase,
-                           uint64_t *__restrict__ n, size_t l,
-                           char *__restrict__ s)
+// number of digits in the largest power of the base below 2^64
+static constexpr unsigned _chunk_digits(uint64_t base)
+{
+    unsigned e = 1;
+    for (uint64_t b = base; b <= UINT64_MAX / base; b *= base)
+        ++e;
+    return e;
+}
+
+// largest power of the base below 2^64 (10^19 for base 10)
+static constexpr uint64_t _chunk_power(uint64_t base)
+{
+    uint64_t b = base;
+    while (b <= UINT64_MAX / base)
+        b *= base;
+    return b;
+}
+
+/*
+fixed width digit kernels for chunks
+the SSE4.1/AVX2 versions check the character class in the same pass, the
+scalar versions are used when the target does not have them
+*/
+
+#if defined(__SSE4_1__)
+// the 8 decimal digits of v < 10^8 in 16 bit lanes (most significant first)
+// v is split into 4 digit halves which are divided by 1000, 100, 10, 1
+// with multiply high by reciprocals, then a*10 is subtracted from ab, etc
+static inline __m128i _dec8_epi16(uint32_t v)
+{
+    short hi = v / 10000, lo = v % 10000;
+    __m128i x = _mm_set_epi16(lo,lo,lo,lo,hi,hi,hi,hi);
+    x = _mm_slli_epi16(x,2);
+    x = _mm_mulhi_epu16(x,_mm_set1_epi64x(0x80003334147b20c5));
+    x = _mm_mulhi_epu16(x,_mm_set1_epi64x(0x8000200008000080));
+    __m128i t = _mm_slli_epi64(_mm_mullo_epi16(x,_mm_set1_epi16(10)),16);
+    return _mm_sub_epi16(x,t);
+}
+#endif
+
+// write the 19 decimal digits of c < 10^19 (zero padded) at s
+static inline void _fmt_dec19(uint64_t c, char *s)
+{
+    assert(c < 10000000000000000000uLL);
+#if defined(__SSE4_1__)
+    uint64_t hi = c / 10000000000000000uLL, lo = c % 10000000000000000uLL;
+    s[0] = '0' + hi/100;
+    s[1] = '0' + hi/10%10;
+    s[2] = '0' + hi%10;
+    __m128i d = _mm_packus_epi16(_dec8_epi16(lo / 100000000),
+                                 _dec8_epi16(lo % 100000000));
+    _mm_storeu_si128((__m128i*)(s+3),_mm_add_epi8(d,_mm_set1_epi8('0')));
+#else
+    for (size_t i = 19; i--;)
+    {
+        s[i] = '0' + c%10;
+        c /= 10;
+    }
+#endif
+}
+
+// write the 16 hex digits of v (zero padded) at s
+static inline void _fmt_hex16(const char *_digits, uint64_t v, char *s)
+{
+#if defined(__SSE4_1__)
+    // byte swap so the nibbles come out most significant first, then use
+    // them as shuffle indexes into the first 16 digits
+    __m128i x = _mm_cvtsi64_si128(__builtin_bswap64(v));
+    __m128i m = _mm_set1_epi8(0x0f);
+    __m128i d = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(x,4),m),
+                                  _mm_and_si128(x,m));
+    __m128i t = _mm_loadu_si128((const __m128i*)_digits);
+    _mm_storeu_si128((__m128i*)s,_mm_shuffle_epi8(t,d));
+#else
+    for (size_t i = 16; i--; v >>= 4)
+        s[i] = _digits[v & 15];
+#endif
+}
+
+// value of the 19 decimal digits at s, sets bad if one is not 0-9
+static inline uint64_t _parse_dec19(const char *s, bool &bad)
+{
+#if defined(__SSE4_1__)
+    // digits are combined in pairs, then 4 and 8 digits with multiply add
+    __m128i d = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)s),
+                             _mm_set1_epi8('0'));
+    __m128i nine = _mm_set1_epi8(9);
+    bad |= _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(d,nine),nine))
+           != 0xffff;
+    d = _mm_maddubs_epi16(d,_mm_set1_epi16(0x010a));
+    d = _mm_madd_epi16(d,_mm_set1_epi32(0x00010064));
+    d = _mm_packus_epi32(d,d);
+    d = _mm_madd_epi16(d,_mm_set1_epi32(0x00012710));
+    uint64_t t = _mm_cvtsi128_si64(d);
+    uint64_t c = (t & 0xffffffff) * 100000000 + (t >> 32);
+    for (size_t i = 16; i < 19; ++i)
+    {
+        uint8_t v = _digitval(s[i]);
+        bad |= v >= 10;
+        c = c*10 + v;
+    }
+    return c;
+#else
+    uint64_t c = 0;
+    for (size_t i = 0; i < 19; ++i)
+    {
+        uint8_t v = _digitval(s[i]);
+        bad |= v >= 10;
+        c = c*10 + v;
+    }
+    return c;
+#endif
+}
+
+#if defined(__SSE4_1__)
+// hex digit values of the bytes in c, sets bad if one is not a hex digit
+static inline __m128i _hexval_epi8(__m128i c, bool &bad)
+{
+    __m128i d = _mm_sub_epi8(c,_mm_set1_epi8('0'));
+    __m128i a = _mm_sub_epi8(_mm_or_si128(c,_mm_set1_epi8(0x20)),
+                             _mm_set1_epi8('a'));
+    __m128i isd = _mm_cmpeq_epi8(_mm_min_epu8(d,_mm_set1_epi8(9)),d);
+    __m128i isa = _mm_cmpeq_epi8(_mm_min_epu8(a,_mm_set1_epi8(5)),a);
+    bad |= _mm_movemask_epi8(_mm_or_si128(isd,isa)) != 0xffff;
+    return _mm_blendv_epi8(_mm_add_epi8(a,_mm_set1_epi8(10)),d,isd);
+}
+#endif
+
+#if defined(__AVX2__)
+// same as _hexval_epi8 for 32 bytes
+static inline __m256i _hexval_epi8(__m256i c, bool &bad)
+{
+    __m256i d = _mm256_sub_epi8(c,_mm256_set1_epi8('0'));
+    __m256i a = _mm256_sub_epi8(_mm256_or_si256(c,_mm256_set1_epi8(0x20)),
+                                _mm256_set1_epi8('a'));
+    __m256i isd = _mm256_cmpeq_epi8(_mm256_min_epu8(d,_mm256_set1_epi8(9)),d);
+    __m256i isa = _mm256_cmpeq_epi8(_mm256_min_epu8(a,_mm256_set1_epi8(5)),a);
+    bad |= _mm256_movemask_epi8(_mm256_or_si256(isd,isa)) != -1;
+    return _mm256_blendv_epi8(_mm256_add_epi8(a,_mm256_set1_epi8(10)),d,isd);
+}
+#endif
+
+// value of the 16 hex digits at s, sets bad if one is not a hex digit
+static inline uint64_t _parse_hex16(const char *s, bool &bad)
+{
+#if defined(__SSE4_1__)
+    // nibble pairs become bytes (most significant first) so byte swap
+    __m128i v = _hexval_epi8(_mm_loadu_si128((const __m128i*)s),bad);
+    v = _mm_maddubs_epi16(v,_mm_set1_epi16(0x0110));
+    v = _mm_packus_epi16(v,v);
+    return __builtin_bswap64(_mm_cvtsi128_si64(v));
+#else
+    uint64_t c = 0;
+    for (size_t i = 0; i < 16; ++i)
+    {
+        uint8_t v = _digitval(s[i]);
+        bad |= v >= 16;
+        c = (c << 4) | v;
+    }
+    return c;
+#endif
+}
+
+// divide {n,l} (modified) by the largest power of D in a limb until it is 0
+// the remainders go in c (least significant first), returns their number
+// requires the highest limb nonzero
+template <uint64_t D>
+static size_t _str_chunks_const(uint64_t *n, size_t l, uint64_t *c)
+{
+    constexpr uint64_t p = _chunk_power(D);
+    size_t m = 0;
+    while (l)
+    {
+        c[m++] = u64arr_ll_div_const<p>(n,l);
+        if (n[l-1] == 0)
+            --l;
+    }
+    return m;
+}
+
+// same as _str_chunks_const for a base known at runtime
+static size_t _str_chunks(uint8_t base, uint64_t *n, size_t l, uint64_t *c)
+{
+    u64arr_ll_divisor_64 dv;
+    u64arr_ll_divisor_64_init(&dv,_chunk_power(base));
+    size_t m = 0;
+    while (l)
+    {
+        c[m++] = u64arr_ll_div_64_pre(n,l,&dv);
+        if (n[l-1] == 0)
+            --l;
+    }
+    return m;
+}
+
+// write {n,l} (modified) most significant digit first, zero padded to w
+// digits (no padding for w = 0, then nothing is written for 0)
+// returns the number of digits
+// the chunks of e digits are all known before writing so the highest one
+// sets the length and the others are written at fixed offsets
+static size_t _write_str_basecase(const char *_digits, uint8_t base,
+                                  uint64_t *n, size_t l, char *s, size_t w)
 {
-    const char *_digits = _digits1;
-    if (uppercase)
-        _digits = _digits2;
-    char *sptr = s;
     while (l and n[l-1] == 0)
         --l;
-    if (!l) // special case for 0
+    // each chunk has more than 56 bits (base^e > 2^64/36)
+    uint64_t *c = new uint64_t[l + l/8 + 1];
+    size_t m;
+    if (base == 10) // common base divides by a compile time constant
+        m = _str_chunks_const<10>(n,l,c);
+    else
+        m = _str_chunks(base,n,l,c);
+    unsigned e = _chunk_digits(base);
+    // digits of the highest chunk (no padding)
+    char top[64];
+    size_t lt = 0;
+    for (uint64_t v = m ? c[m-1] : 0; v; v /= base)
+        top[lt++] = _digits[v % base];
+    size_t len = m ? (m-1)*e + lt : 0;
+    char *sptr = s;
+    if (w)
     {
-        s[0] = '0';
-        s[1] = '\0';
+        assert(len <= w);
+        std::fill(sptr,sptr+w-len,'0');
+        sptr += w-len;
+    }
+    std::reverse_copy(top,top+lt,sptr);
+    sptr += lt;
+    for (size_t i = m ? m-1 : 0; i--; sptr += e)
+    {
+        if (base == 10)
+            _fmt_dec19(c[i],sptr);
+        else
+        {
+            uint64_t v = c[i];
+            for (size_t k = e; k--; v /= base)
+                sptr[k] = _digits[v % base];
+        }
+    }
+    delete[] c;
+    return sptr - s;
+}
+
+// write {n,l} in base 2^b without modifying it, zero padded to w digits
+// (no padding for w = 0, then the highest limb must be nonzero)
+// each digit is a bit field of the limbs (which may cross a limb boundary
+// when b does not divide 64), returns the number of digits
+template <unsigned b>
+static size_t _write_str_pow2(const char *_digits, const uint64_t *n, size_t l,
+                              char *s, size_t w)
+{
+    assert(l ? n[l-1] : w);
+    constexpr uint64_t mask = (1uLL << b) - 1;
+    size_t bits = l ? 64*l - __builtin_clzll(n[l-1]) : 0;
+    size_t len = (bits+b-1)/b;
+    if (w)
+    {
+        assert(len <= w);
+        std::fill(s,s+w-len,'0');
+        s += w-len;
+        if (!l)
+            return w;
+    }
+    char *sptr = s + len;
+    if constexpr (64 % b == 0)
+    {
+        // whole limbs of 64/b digits, then the top limb without padding
+        for (size_t j = 0; j < l-1; ++j)
+        {
+            uint64_t v = n[j];
+            if constexpr (b == 4)
+            {
+                sptr -= 16;
+                _fmt_hex16(_digits,v,sptr);
+            }
+            else
+                for (unsigned k = 0; k < 64/b; ++k, v >>= b)
+                    *(--sptr) = _digits[v & mask];
+        }
+        for (uint64_t v = n[l-1]; v; v >>= b)
+            *(--sptr) = _digits[v & mask];
+        assert(sptr == s);
+        return w ? w : len;
+    }
+    // digits from the least significant with a bit buffer of nb bits
+    uint64_t acc = 0;
+    unsigned nb = 0;
+    for (size_t j = 0; j < l; ++j)
+    {
+        uint64_t v = n[j];
+        if (nb) // digit crossing the limb boundary
+        {
+            *(--sptr) = _digits[(acc | (v << nb)) & mask];
+            v >>= b - nb;
+            nb = 64 - (b - nb);
+        }
+        else
+            nb = 64;
+        for (; nb >= b and sptr > s; nb -= b, v >>= b)
+            *(--sptr) = _digits[v & mask];
+        acc = v;
+    }
+    if (sptr > s)
+        *(--sptr) = _digits[acc & mask];
+    assert(sptr == s);
+    return w ? w : len;
+}
+
+// {n,} = value of the len digits at s in base 2^b
+// digits are packed into limbs from the least significant digit,
+// returns the number of limbs (leading zeros are not stored)
+// or 0 if there is a character which is not a digit
+template <unsigned b>
+static size_t _read_str_pow2(const char *s, size_t len, uint64_t *n)
+{
+    while (len and *s == '0')
+    {
+        ++s;
+        --len;
+    }
+    if (!len)
+    {
+        n[0] = 0;
         return 1;
     }
-    while (l) // write digits starting from least significant
+    uint8_t top = _digitval(*s);
+    if (top >> b)
+        return 0;
+    size_t bits = (len-1)*b + (32 - __builtin_clz(top));
+    size_t l = (bits+63)/64, j = 0;
+    bool bad = false;
+    const char *sptr = s + len;
+    if constexpr (b == 4)
     {
-        *(sptr++) = _digits[u64arr_ll_div_32(n,l,base)];
-        if (n[l-1] == 0)
-            --l;
+        // whole limbs of 16 digits, then the digits of the top limb
+#if defined(__AVX2__)
+        for (; sptr - s >= 32; sptr -= 32, j += 2)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(sptr-32));
+            v = _hexval_epi8(v,bad);
+            v = _mm256_maddubs_epi16(v,_mm256_set1_epi16(0x0110));
+            v = _mm256_packus_epi16(v,v);
+            n[j] = __builtin_bswap64(_mm256_extract_epi64(v,2));
+            n[j+1] = __builtin_bswap64(_mm256_extract_epi64(v,0));
+        }
+#endif
+        for (; sptr - s >= 16; sptr -= 16)
+            n[j++] = _parse_hex16(sptr-16,bad);
+        if (sptr > s)
+        {
+            uint64_t v = 0;
+            for (const char *t = s; t < sptr; ++t)
+            {
+                uint8_t d = _digitval(*t);
+                bad |= d >= 16;
+                v = (v << 4) | d;
+            }
+            n[j++] = v;
+        }
+        assert(j == l);
+        return bad ? 0 : l;
     }
-    *sptr = '\0';
-    size_t ret = sptr - s;
-    --sptr;
-    while (s < sptr) // reverse digit order
+    uint64_t acc = 0;
+    unsigned nb = 0;
+    while (sptr > s)
     {
-        char tmp = *s;
-        *(s++) = *sptr;
-        *(sptr--) = tmp;
+        uint64_t d = _digitval(*(--sptr));
+        bad |= d >> b;
+        acc |= d << nb;
+        nb += b;
+        if (nb >= 64)
+        {
+            n[j++] = acc;
+            nb -= 64;
+            acc = d >> (b - nb); // bits which did not fit
+        }
     }
-    return ret;
+    if (j < l)
+        n[j++] = acc;
+    assert(j == l);
+    return bad ? 0 : l;
 }
 
-size_t u64arr_ll_read_str(uint8_t base,
-                          const char *__restrict__ s,
-                          uint64_t *__restrict__ n)
+// {n,} = value of the len digits at s, returns the number of limbs
+// or 0 if there is a character which is not a digit in the base
+// digits are collected into chunks of the largest power of the base in a
+// limb so each pass over n multiplies by a whole chunk
+static size_t _read_str_basecase(uint8_t base, const char *s, size_t len,
+                                 uint64_t *n)
 {
+    unsigned e = _chunk_digits(base);
     size_t l = 1;
     n[0] = 0;
-    while (*s)
+    bool bad = false;
+    for (size_t i = 0; i < len;)
     {
-        uint8_t d = _digitval(*(s++));
-        uint64_t cm = u64arr_ll_mul_64(n,l,base);
+        size_t k = std::min((size_t)e,len-i);
+        uint64_t c = 0, p = 1;
+        if (base == 10 and k == 19)
+        {
+            c = _parse_dec19(s+i,bad);
+            p = _chunk_power(10);
+            i += k;
+        }
+        else
+            for (size_t j = 0; j < k; ++j)
+            {
+                uint8_t v = _digitval(s[i++]);
+                bad |= v >= base;
+                c = c*base + v;
+                p *= base;
+            }
+        uint64_t cm = u64arr_ll_mul_64(n,l,p);
         if (cm)
             n[l++] = cm;
-        bool ca = u64arr_ll_add_64(n,l,d);
+        bool ca = u64arr_ll_add_64(n,l,c);
         if (ca)
             n[l++] = 1;
     }
-    return l;
+    return bad ? 0 : l;
+}
+
+// _read_str_basecase, or the linear conversion for power of 2 bases
+// n must have room for ceil(len/e) limbs (base^e is below 2^64)
+static size_t _read_str_block(uint8_t base, const char *s, size_t len,
+                              uint64_t *n)
+{
+    switch (base)
+    {
+    case 2:
+        return _read_str_pow2<1>(s,len,n);
+    case 4:
+        return _read_str_pow2<2>(s,len,n);
+    case 8:
+        return _read_str_pow2<3>(s,len,n);
+    case 16:
+        return _read_str_pow2<4>(s,len,n);
+    case 32:
+        return _read_str_pow2<5>(s,len,n);
+    default:
+        return _read_str_basecase(base,s,len,n);
+    }
 }
 
 bool u64arr_ll_add_to(uint64_t *__restrict__ n1, size_t l1,
@@ -200,10 +780,10 @@ bool u64arr_ll_sub_from(uint64_t *__restrict__ n1, size_t l1,
         n1[i] = tmp;
     }
     if (c) // leaves rest of {n1,l1} unchanged
-        return true;
+        return false;
     while (i < l1 and !c)
         c = (n1[i++]-- != 0);
-    return c;
+    return !c;
 }
 
 bool u64arr_ll_add(const uint64_t *__restrict__ x, size_t lx,
@@ -248,12 +828,12 @@ bool u64arr_ll_sub(const uint64_t *__restrict__ x, size_t lx,
     while (i < lx) // finish {x,lx}
     {
         z[i] = x[i] - (!c);
-        c |= z[i++];
+        c |= (x[i++] != 0);
     }
     while (i < ly) // finish {y,ly}
     {
         z[i] = (~y[i]) + c;
-        c &= (y[i] == 0);
+        c &= (y[i++] == 0);
     }
     return !c;
 }
@@ -278,128 +858,3611 @@ struct _add128
 
 static_assert(sizeof(_add128) == 24);
 
-void u64arr_ll_mul(const uint64_t *__restrict__ x, size_t lx,
-                   const uint64_t *__restrict__ y, size_t ly,
-                   uint64_t *__restrict__ z)
+// multiplication thresholds (length of shorter operand in limbs)
+// these can be overridden with -D to tune for a specific machine
+#ifndef U64ARR_LL_MUL_KARATSUBA_THRESHOLD
+#define U64ARR_LL_MUL_KARATSUBA_THRESHOLD 40
+#endif
+// squaring uses the same thresholds except for leaving the basecase and
+// starting the transforms (FFT squaring saves nothing over multiplication)
+#ifndef U64ARR_LL_SQR_KARATSUBA_THRESHOLD
+#define U64ARR_LL_SQR_KARATSUBA_THRESHOLD 72
+#endif
+#ifndef U64ARR_LL_SQR_FFT_THRESHOLD
+#define U64ARR_LL_SQR_FFT_THRESHOLD 1500
+#endif
+#ifndef U64ARR_LL_MUL_TOOM3_THRESHOLD
+#define U64ARR_LL_MUL_TOOM3_THRESHOLD 600
+#endif
+#ifndef U64ARR_LL_MUL_TOOM4_THRESHOLD
+#define U64ARR_LL_MUL_TOOM4_THRESHOLD 1000
+#endif
+// the transforms must start above toom-4 or it is never used
+#ifndef U64ARR_LL_MUL_NTT_THRESHOLD
+#define U64ARR_LL_MUL_NTT_THRESHOLD 1200
+#endif
+#ifndef U64ARR_LL_MUL_FFT_THRESHOLD
+#define U64ARR_LL_MUL_FFT_THRESHOLD 1200
+#endif
+// smallest piece width for the FFT, larger inputs use the NTT
+#ifndef U64ARR_LL_MUL_FFT_MIN_BITS
+#define U64ARR_LL_MUL_FFT_MIN_BITS 13
+#endif
+// FFT blocks up to this length (power of 2) are transformed breadth first
+#ifndef U64ARR_LL_FFT_BLOCK
+#define U64ARR_LL_FFT_BLOCK 4096
+#endif
+// u64arr_ll_mul_mt does products with lx+ly below this many limbs (and
+// transforms shorter than U64ARR_LL_MT_TRANSFORM_LEN) on a single thread
+#ifndef U64ARR_LL_MUL_MT_THRESHOLD
+#define U64ARR_LL_MUL_MT_THRESHOLD 2000
+#endif
+#ifndef U64ARR_LL_MT_TRANSFORM_LEN
+#define U64ARR_LL_MT_TRANSFORM_LEN 16384
+#endif
+// short products (u64arr_ll_mullo/mulhi) are done by rows below these
+#ifndef U64ARR_LL_MULLO_THRESHOLD
+#define U64ARR_LL_MULLO_THRESHOLD 160
+#endif
+#ifndef U64ARR_LL_MULHI_THRESHOLD
+#define U64ARR_LL_MULHI_THRESHOLD 160
+#endif
+// the error bound documented for u64arr_ll_mulhi needs this
+static_assert(U64ARR_LL_MULHI_THRESHOLD >= 10);
+// division by divisors shorter than this is schoolbook, at least this
+// long uses divide and conquer (on the quotient length)
+#ifndef U64ARR_LL_DIV_DC_THRESHOLD
+#define U64ARR_LL_DIV_DC_THRESHOLD 60
+#endif
+// division by divisors at least this long uses a newton reciprocal when
+// it is reused for at least 2 blocks of the quotient (see _div)
+#ifndef U64ARR_LL_DIV_NEWTON_THRESHOLD
+#define U64ARR_LL_DIV_NEWTON_THRESHOLD 4000
+#endif
+// reciprocals shorter than this are computed by division
+#ifndef U64ARR_LL_INV_NEWTON_THRESHOLD
+#define U64ARR_LL_INV_NEWTON_THRESHOLD 200
+#endif
+// exact division (Hensel) with the shorter of the divisor and quotient
+// at least this long uses divide and conquer, or a newton inverse
+// blocks which update all of x (qr) and the last which only computes the
+// quotient (q) have separate divide and conquer thresholds
+#ifndef U64ARR_LL_DIVEXACT_DC_THRESHOLD
+#define U64ARR_LL_DIVEXACT_DC_THRESHOLD 60
+#endif
+#ifndef U64ARR_LL_DIVEXACT_Q_DC_THRESHOLD
+#define U64ARR_LL_DIVEXACT_Q_DC_THRESHOLD 300
+#endif
+// the newton inverse is only used when it is reused for 2 or more blocks
+#ifndef U64ARR_LL_DIVEXACT_NEWTON_THRESHOLD
+#define U64ARR_LL_DIVEXACT_NEWTON_THRESHOLD 2000
+#endif
+// schoolbook division needs 2 limb divisors, newton steps need h < n
+static_assert(U64ARR_LL_DIV_DC_THRESHOLD >= 2);
+static_assert(U64ARR_LL_INV_NEWTON_THRESHOLD >= 4);
+
+// compare {x,lx} and {y,ly}
+// returns -1 if x < y, 0 if x == y, 1 if x > y
+static int _cmp(const uint64_t *x, size_t lx, const uint64_t *y, size_t ly)
 {
-    assert(lx > 0 and ly > 0);
-    _add128 *sums = new _add128[lx+ly-1]();
-    uint64_t v0, v1, tmp;
+    while (lx > ly)
+        if (x[--lx])
+            return 1;
+    while (ly > lx)
+        if (y[--ly])
+            return -1;
+    for (size_t i = lx; i--;)
+        if (x[i] != y[i])
+            return x[i] < y[i] ? -1 : 1;
+    return 0;
+}
+
+// {z,max(lx,ly)} = |{x,lx} - {y,ly}|
+// returns true if {x,lx} < {y,ly}
+static bool _sub_abs(const uint64_t *x, size_t lx,
+                     const uint64_t *y, size_t ly, uint64_t *z)
+{
+    size_t l = (lx > ly ? lx : ly);
+    bool neg = (_cmp(x,lx,y,ly) < 0);
+    if (neg)
+    {
+        std::swap(x,y);
+        std::swap(lx,ly);
+    }
+    if (ly > lx) // upper limbs of {y,ly} must be zero
+        ly = lx;
+    bool o = u64arr_ll_sub(x,lx,y,ly,z);
+    assert(!o);
+    for (size_t i = lx; i < l; ++i)
+        z[i] = 0;
+    return neg;
+}
+
+// shift {n,l} left by s bits (0 < s < 64)
+// returns the bits shifted out of the highest limb
+static uint64_t _shl(uint64_t *n, size_t l, unsigned s)
+{
+    uint64_t c = 0, tmp;
+    for (size_t i = 0; i < l; ++i)
+    {
+        tmp = n[i];
+        n[i] = (tmp << s) | c;
+        c = tmp >> (64-s);
+    }
+    return c;
+}
+
+// shift {n,l} right by s bits (0 < s < 64)
+static void _shr(uint64_t *n, size_t l, unsigned s)
+{
+    for (size_t i = 0; i < l-1; ++i)
+        n[i] = (n[i] >> s) | (n[i+1] << (64-s));
+    n[l-1] >>= s;
+}
+
+// {z,lz} = {x,lx} with zero padding, requires lz >= lx
+static inline void _copy_pad(const uint64_t *x, size_t lx,
+                             uint64_t *z, size_t lz)
+{
+    assert(lz >= lx);
     for (size_t i = 0; i < lx; ++i)
-        for (size_t j = 0; j < ly; ++j)
+        z[i] = x[i];
+    for (size_t i = lx; i < lz; ++i)
+        z[i] = 0;
+}
+
+// runs the independent tasks f(i) for i < k using up to threads threads
+// (including the calling thread), thread j does tasks j, j+threads, ...
+template <typename F>
+static void _run_tasks(size_t k, unsigned threads, const F &f)
+{
+    size_t nt = std::min((size_t)std::max(threads,1u),k);
+    std::thread *pool = nt > 1 ? new std::thread[nt-1] : nullptr;
+    for (size_t j = 1; j < nt; ++j)
+        pool[j-1] = std::thread([&f,j,k,nt]()
         {
-            _mul64full(x[i],y[j],&v0,&v1);
-            sums[i+j]._add(v0,v1);
-        }
-    // 3 pass addition
-    for (size_t i = 0; i < lx+ly-1; ++i) // low
-        z[i] = sums[i]._u0;
-    bool c = false;
-    for (size_t i = 0; i < lx+ly-1; ++i) // middle
+            for (size_t i = j; i < k; i += nt)
+                f(i);
+        });
+    for (size_t i = 0; i < k; i += nt)
+        f(i);
+    for (size_t j = 1; j < nt; ++j)
+        pool[j-1].join();
+    delete[] pool;
+}
+
+// runs f(i0,i1) on up to threads nonempty ranges which partition [0,n)
+template <typename F>
+static void _run_ranges(size_t n, unsigned threads, const F &f)
+{
+    size_t k = std::min((size_t)std::max(threads,1u),n);
+    _run_tasks(k,threads,[&f,n,k](size_t i) { f(n*i/k,n*(i+1)/k); });
+}
+
+// number of threads for task i when k tasks share threads threads
+static inline unsigned _task_threads(size_t k, unsigned threads, size_t i)
+{
+    if (k >= threads)
+        return 1;
+    return threads/k + (i < threads%k);
+}
+
+// {z,n} = {y,n} * a
+// returns the carry limb
+static inline uint64_t _mul_1(uint64_t *__restrict__ z,
+                              const uint64_t *__restrict__ y, size_t n,
+                              uint64_t a)
+{
+    uint64_t c = 0;
+    for (size_t i = 0; i < n; ++i)
     {
-        // TODO see comment in u64arr_ll_add_to
-        tmp = z[i+1] + sums[i]._u1 + c;
-        c = (tmp < z[i+1]) or (c and tmp <= z[i+1]);
-        z[i+1] = tmp;
+        __uint128_t m = (__uint128_t)y[i] * a + c;
+        z[i] = m;
+        c = m >> 64;
     }
-    assert(!c);
-    for (size_t i = 0; i < lx+ly-2; ++i) // high
+    return c;
+}
+
+// {z,n} += {y,n} * a
+// returns the carry limb
+// with BMI2 and ADX, groups of 4 limbs use mulx with 2 independent carry
+// chains (adox for the high halves, adcx for adding to z)
+static inline uint64_t _addmul_1(uint64_t *__restrict__ z,
+                                 const uint64_t *__restrict__ y, size_t n,
+                                 uint64_t a)
+{
+    uint64_t c = 0;
+#if defined(__BMI2__) and defined(__ADX__)
+    size_t r = n % 4;
+#else
+    size_t r = n;
+#endif
+    for (size_t i = 0; i < r; ++i)
     {
-        tmp = z[i+2] + sums[i]._u2 + c;
-        c = (tmp < z[i+2]) or (c and tmp <= z[i+2]);
-        z[i+2] = tmp;
+        __uint128_t m = (__uint128_t)y[i] * a + z[i] + c;
+        z[i] = m;
+        c = m >> 64;
     }
-    assert(!c);
-    assert(sums[lx+ly-2]._u2 == 0);
-    delete[] sums;
+#if defined(__BMI2__) and defined(__ADX__)
+    if (n == r)
+        return c;
+    // negative index counting up to 0 in rcx for jrcxz (no flags changed)
+    int64_t i = -(int64_t)(n-r);
+    uint64_t l0, h0, l1, h1;
+    // volatile since callers may ignore the carry but need the stores
+    __asm__ volatile
+    (
+        "xor %k[l0], %k[l0]\n\t" // clear CF and OF
+        "1:\n\t"
+        "mulx (%[y],%[i],8), %[l0], %[h0]\n\t"
+        "mulx 8(%[y],%[i],8), %[l1], %[h1]\n\t"
+        "adox %[c], %[l0]\n\t"
+        "adcx (%[z],%[i],8), %[l0]\n\t"
+        "mov %[l0], (%[z],%[i],8)\n\t"
+        "adox %[h0], %[l1]\n\t"
+        "adcx 8(%[z],%[i],8), %[l1]\n\t"
+        "mov %[l1], 8(%[z],%[i],8)\n\t"
+        "mulx 16(%[y],%[i],8), %[l0], %[h0]\n\t"
+        "mulx 24(%[y],%[i],8), %[l1], %[c]\n\t"
+        "adox %[h1], %[l0]\n\t"
+        "adcx 16(%[z],%[i],8), %[l0]\n\t"
+        "mov %[l0], 16(%[z],%[i],8)\n\t"
+        "adox %[h0], %[l1]\n\t"
+        "adcx 24(%[z],%[i],8), %[l1]\n\t"
+        "mov %[l1], 24(%[z],%[i],8)\n\t"
+        "lea 4(%[i]), %[i]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "mov $0, %k[l0]\n\t" // the carries fit since the result does
+        "adox %[l0], %[c]\n\t"
+        "adcx %[l0], %[c]"
+        : [c]"+&r"(c), [i]"+&c"(i),
+          [l0]"=&r"(l0), [h0]"=&r"(h0), [l1]"=&r"(l1), [h1]"=&r"(h1)
+        : [y]"r"(y+n), [z]"r"(z+n), "d"(a)
+        : "cc", "memory"
+    );
+#endif
+    return c;
 }
 
-// divide 2 equal length numbers {z,l} / {y,l}
-// return quotient and store remainder in {z,l}
-// requires highest limb in y is nonzero
-static inline uint64_t u64arr_ll_div_helper(const uint64_t *__restrict__ y,
-                                            uint64_t *__restrict__ z, size_t l)
+// {z,n} -= {y,n} * a
+// returns the borrow limb
+// with BMI2 and ADX, uses the same kernel as _addmul_1 on the complement
+// since z - p = ~(~z + p) and the carry out of ~z + p is the borrow
+static inline uint64_t _submul_1(uint64_t *__restrict__ z,
+                                 const uint64_t *__restrict__ y, size_t n,
+                                 uint64_t a)
 {
-    assert(l > 0 and y[l-1] and z[l-1]);
-    uint64_t ret = 0;
-    uint64_t *yy = new uint64_t[l];
-    for (size_t i = 0; i < l; ++i)
-        yy[i] = y[i];
-    // shift {yy,l} as much as possible while it is <= {z,l}
-    // attempt based on highest limb first
-    size_t s = 0;
-    while (!(yy[l-1] >> 63) and (yy[l-1] << 1) <= z[l-1])
+    uint64_t c = 0;
+#if defined(__BMI2__) and defined(__ADX__)
+    size_t r = n % 4;
+#else
+    size_t r = n;
+#endif
+    for (size_t i = 0; i < r; ++i)
     {
-        yy[l-1] <<= 1;
-        ++s;
+        __uint128_t m = (__uint128_t)y[i] * a + c;
+        uint64_t lo = m, zi = z[i];
+        z[i] = zi - lo;
+        c = (uint64_t)(m >> 64) + (zi < lo);
     }
-    if (s) // need to shift the rest of the limbs
-        for (size_t i = l-1; i--;)
-        {
-            yy[i+1] = (yy[i] >> (64-s));
-            yy[i] <<= s;
-        }
-    // make sure {yy,l} <= {z,l}
-    bool yyleq = true;
-    for (size_t i = l; i--;)
+#if defined(__BMI2__) and defined(__ADX__)
+    if (n == r)
+        return c;
+    int64_t i = -(int64_t)(n-r);
+    uint64_t l0, h0, l1, h1, w;
+    __asm__ volatile
+    (
+        "xor %k[l0], %k[l0]\n\t"
+        "1:\n\t"
+        "mulx (%[y],%[i],8), %[l0], %[h0]\n\t"
+        "mulx 8(%[y],%[i],8), %[l1], %[h1]\n\t"
+        "adox %[c], %[l0]\n\t"
+        "mov (%[z],%[i],8), %[w]\n\t"
+        "not %[w]\n\t"
+        "adcx %[l0], %[w]\n\t"
+        "not %[w]\n\t"
+        "mov %[w], (%[z],%[i],8)\n\t"
+        "adox %[h0], %[l1]\n\t"
+        "mov 8(%[z],%[i],8), %[w]\n\t"
+        "not %[w]\n\t"
+        "adcx %[l1], %[w]\n\t"
+        "not %[w]\n\t"
+        "mov %[w], 8(%[z],%[i],8)\n\t"
+        "mulx 16(%[y],%[i],8), %[l0], %[h0]\n\t"
+        "mulx 24(%[y],%[i],8), %[l1], %[c]\n\t"
+        "adox %[h1], %[l0]\n\t"
+        "mov 16(%[z],%[i],8), %[w]\n\t"
+        "not %[w]\n\t"
+        "adcx %[l0], %[w]\n\t"
+        "not %[w]\n\t"
+        "mov %[w], 16(%[z],%[i],8)\n\t"
+        "adox %[h0], %[l1]\n\t"
+        "mov 24(%[z],%[i],8), %[w]\n\t"
+        "not %[w]\n\t"
+        "adcx %[l1], %[w]\n\t"
+        "not %[w]\n\t"
+        "mov %[w], 24(%[z],%[i],8)\n\t"
+        "lea 4(%[i]), %[i]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "mov $0, %k[l0]\n\t"
+        "adox %[l0], %[c]\n\t"
+        "adcx %[l0], %[c]"
+        : [c]"+&r"(c), [i]"+&c"(i), [l0]"=&r"(l0), [h0]"=&r"(h0),
+          [l1]"=&r"(l1), [h1]"=&r"(h1), [w]"=&r"(w)
+        : [y]"r"(y+n), [z]"r"(z+n), "d"(a)
+        : "cc", "memory"
+    );
+#endif
+    return c;
+}
+
+// {z,n+1} = {z,n} + {y,n} * {a,2}
+// returns the highest limb of the result
+// both products of y[i] are added in the same pass with a 2 limb carry
+static inline uint64_t _addmul_2(uint64_t *__restrict__ z,
+                                 const uint64_t *__restrict__ y, size_t n,
+                                 const uint64_t *__restrict__ a)
+{
+    uint64_t c0 = 0, c1 = 0; // carry into limbs i and i+1
+    for (size_t i = 0; i < n; ++i)
     {
-        if (yy[i] == z[i])
-            continue;
-        else
-        {
-            yyleq = (yy[i] < z[i]);
-            break;
-        }
+        __uint128_t m = (__uint128_t)y[i] * a[0] + z[i] + c0;
+        z[i] = m;
+        m = (__uint128_t)y[i] * a[1] + (uint64_t)(m >> 64) + c1;
+        c0 = m;
+        c1 = m >> 64;
     }
-    if (!yyleq) // either {y,l} > {z,l} or we shifted 1 bit too much
+    z[n] = c0;
+    return c1;
+}
+
+uint64_t u64arr_ll_addmul_64(uint64_t *__restrict__ n1,
+                             const uint64_t *__restrict__ n2, size_t l,
+                             uint64_t a)
+{
+    return _addmul_1(n1,n2,l,a);
+}
+
+uint64_t u64arr_ll_submul_64(uint64_t *__restrict__ n1,
+                             const uint64_t *__restrict__ n2, size_t l,
+                             uint64_t a)
+{
+    return _submul_1(n1,n2,l,a);
+}
+
+uint64_t u64arr_ll_addmul_2(uint64_t *__restrict__ n1,
+                            const uint64_t *__restrict__ n2, size_t l,
+                            const uint64_t *__restrict__ a)
+{
+    return _addmul_2(n1,n2,l,a);
+}
+
+// grid multiplication, {z,lx+ly} = {x,lx} * {y,ly}
+// done by rows, adding {y,ly}*x[i] to z at limb i
+static void _mul_basecase(const uint64_t *__restrict__ x, size_t lx,
+                          const uint64_t *__restrict__ y, size_t ly,
+                          uint64_t *__restrict__ z)
+{
+    assert(lx > 0 and ly > 0);
+    z[ly] = _mul_1(z,y,ly,x[0]);
+    for (size_t i = 1; i < lx; ++i)
+        z[i+ly] = _addmul_1(z+i,y,ly,x[i]);
+}
+
+// grid squaring, {z,2l} = {x,l}^2
+// only products x[i]*x[j] with i < j are computed (by rows), the sum is
+// doubled, then the squares x[i]*x[i] are added
+static void _sqr_basecase(const uint64_t *__restrict__ x, size_t l,
+                          uint64_t *__restrict__ z)
+{
+    assert(l > 0);
+    z[0] = 0;
+    z[2*l-1] = 0;
+    if (l > 1)
+        z[l] = _mul_1(z+1,x+1,l-1,x[0]);
+    for (size_t i = 1; i+1 < l; ++i)
+        z[i+l] = _addmul_1(z+2*i+1,x+i+1,l-i-1,x[i]);
+    uint64_t c = 0, s = 0; // carry limb and bit shifted out
+    for (size_t i = 0; i < l; ++i)
     {
-        if (s == 0) // did not shift so {y,l} > {z,l}
-            return 0;
-        else // shifted 1 bit too much
-        {
-            for (size_t i = 0; i < l-1; ++i)
-                yy[i] = (yy[i] >> 1) | (yy[i+1] << 63);
-            yy[l-1] >>= 1;
-        }
+        __uint128_t m = (__uint128_t)x[i] * x[i];
+        uint64_t z0 = z[2*i], z1 = z[2*i+1];
+        __uint128_t v = (__uint128_t)((z0 << 1) | s) + (uint64_t)m + c;
+        z[2*i] = v;
+        s = z1 >> 63;
+        v = (__uint128_t)((z1 << 1) | (z0 >> 63)) + (uint64_t)(m >> 64)
+            + (uint64_t)(v >> 64);
+        z[2*i+1] = v;
+        c = v >> 64;
     }
-    ++s;
-    while (s--) // repeatedly compare and shift to set quotient bits
+    assert(!c and !s);
+}
+
+/*
+number theoretic transform (NTT) multiplication
+the limbs are convolved modulo 3 primes p = c*2^54+1 < 2^63 and the exact
+coefficients (< min(lx,ly)*2^128 < p0*p1*p2 ~ 2^188) are recovered with
+the chinese remainder theorem
+*/
+
+// primes for the NTT and a generator of the multiplicative group of each
+static const uint64_t _ntt_p[3] = {0x7E40000000000001uLL,
+                                   0x7740000000000001uLL,
+                                   0x6DC0000000000001uLL};
+static const uint64_t _ntt_g[3] = {6, 11, 3};
+
+// (a*b) mod p, requires a*b < p*2^64
+static inline uint64_t _mulmod(uint64_t a, uint64_t b, uint64_t p)
+{
+    uint64_t m0, m1, r;
+    _mul64full(a,b,&m0,&m1);
+    _udiv64_1(m0,m1,p,nullptr,&r);
+    return r;
+}
+
+// (a^e) mod p, requires a < p
+static uint64_t _powmod(uint64_t a, uint64_t e, uint64_t p)
+{
+    uint64_t r = 1;
+    while (e)
     {
-        // test if {z,l} >= {yy,l}
-        size_t j = l-1;
-        while (j and z[j] == yy[j])
-            --j;
-        if (z[j] >= yy[j]) // set bit in quotient (ret) and subtract
-        {
-            ret |= (1uLL << s);
-            bool o = u64arr_ll_sub_from(z,l,yy,l);
-            assert(!o);
-        }
-        // shift right 1 bit
-        for (size_t i = 0; i < l-1; ++i)
-            yy[i] = (yy[i] >> 1) | (yy[i+1] << 63);
-        yy[l-1] >>= 1;
+        if (e & 1)
+            r = _mulmod(r,a,p);
+        a = _mulmod(a,a,p);
+        e >>= 1;
     }
-    delete[] yy;
-    return ret;
+    return r;
 }
 
-void u64arr_ll_div(const uint64_t *__restrict__ x, size_t lx,
-                   const uint64_t *__restrict__ y, size_t ly,
-                   uint64_t *__restrict__ q,
-                   uint64_t *__restrict__ r)
+// precomputed quotient floor(w*2^64/p) for multiplying by w modulo p
+// (shoup's method, replaces a division by a multiplication)
+static inline uint64_t _shoup_pre(uint64_t w, uint64_t p)
 {
-    assert(lx >= ly and ly > 0);
-    assert(y[ly-1]);
-    // create a copy of x to work with
-    uint64_t *z = new uint64_t[lx];
-    for (size_t i = 0; i < lx; ++i)
-        z[i] = x[i];
-    // create the quotient limb by limb
-    size_t qi = lx-ly+1;
-    while (qi--)
-        q[qi] = u64arr_ll_div_helper(y,z+qi,ly);
-    for (size_t i = 0; i < ly; ++i)
-        r[i] = z[i];
-    delete[] z;
+    uint64_t q;
+    _udiv64_1(0,w,p,&q,nullptr);
+    return q;
+}
+
+// (a*w) mod p with wq = _shoup_pre(w,p), requires w < p < 2^63
+static inline uint64_t _shoup_mulmod(uint64_t a, uint64_t w, uint64_t wq,
+                                     uint64_t p)
+{
+    uint64_t r = a*w - _mul64hi(a,wq)*p; // in [0,2p)
+    return r - (r >= p)*p;
+}
+
+// transform length for multiplying {x,lx} * {y,ly}
+static size_t _ntt_len(size_t lx, size_t ly)
+{
+    size_t n = 1;
+    while (n < lx+ly-1)
+        n <<= 1;
+    return n;
+}
+
+// twiddle factors for transforms of length n (power of 2) modulo p
+// w[k+j] = r^j for k = 1,2,4,...,n/2 and j < k where r has order 2k
+// wq[k+j] = _shoup_pre(w[k+j],p)
+static void _ntt_twiddles(size_t n, uint64_t p, uint64_t g,
+                          uint64_t *w, uint64_t *wq)
+{
+    if (n < 2)
+        return;
+    size_t k = n/2;
+    uint64_t r = _powmod(g,(p-1)/n,p), rq = _shoup_pre(r,p), v = 1;
+    for (size_t j = 0; j < k; ++j)
+    {
+        w[k+j] = v;
+        wq[k+j] = _shoup_pre(v,p);
+        v = _shoup_mulmod(v,r,rq,p);
+    }
+    // r^2 has half the order so smaller levels use every other element
+    for (k /= 2; k; k /= 2)
+        for (size_t j = 0; j < k; ++j)
+        {
+            w[k+j] = w[2*k+2*j];
+            wq[k+j] = wq[2*k+2*j];
+        }
+}
+
+// forward transform (decimation in frequency) of {a,n} modulo p
+// input is in natural order and output is in bit reversed order
+static void _ntt_fwd(uint64_t *a, size_t n, uint64_t p,
+                     const uint64_t *w, const uint64_t *wq)
+{
+    for (size_t k = n/2; k; k /= 2)
+        for (size_t i = 0; i < n; i += 2*k)
+            for (size_t j = 0; j < k; ++j)
+            {
+                uint64_t u = a[i+j], v = a[i+j+k];
+                uint64_t s = u + v;
+                a[i+j] = s - (s >= p)*p;
+                a[i+j+k] = _shoup_mulmod(u-v+p,w[k+j],wq[k+j],p);
+            }
+}
+
+// inverse transform (decimation in time) of {a,n} modulo p without the
+// division by n, input is in bit reversed order and output is natural order
+// uses r^-j = -r^(k-j) since r^k = -1 so the same twiddles work
+static void _ntt_inv(uint64_t *a, size_t n, uint64_t p,
+                     const uint64_t *w, const uint64_t *wq)
+{
+    for (size_t k = 1; k < n; k *= 2)
+        for (size_t i = 0; i < n; i += 2*k)
+        {
+            uint64_t u = a[i], v = a[i+k];
+            uint64_t s = u + v;
+            a[i] = s - (s >= p)*p;
+            s = u - v + p;
+            a[i+k] = s - (s >= p)*p;
+            for (size_t j = 1; j < k; ++j)
+            {
+                // v = -a[i+j+k]*r^-j
+                u = a[i+j];
+                v = _shoup_mulmod(a[i+j+k],w[2*k-j],wq[2*k-j],p);
+                s = u - v + p;
+                a[i+j] = s - (s >= p)*p;
+                s = u + v;
+                a[i+j+k] = s - (s >= p)*p;
+            }
+        }
+}
+
+// butterflies j0 <= j < j1 of a forward transform stage on the block {a,2k}
+// for splitting a stage among threads (_ntt_fwd and _ntt_inv keep their own
+// loops since that measured faster)
+static inline void _ntt_fwd_span(uint64_t *a, size_t k, size_t j0, size_t j1,
+                                 uint64_t p, const uint64_t *w,
+                                 const uint64_t *wq)
+{
+    for (size_t j = j0; j < j1; ++j)
+    {
+        uint64_t u = a[j], v = a[j+k];
+        uint64_t s = u + v;
+        a[j] = s - (s >= p)*p;
+        a[j+k] = _shoup_mulmod(u-v+p,w[k+j],wq[k+j],p);
+    }
+}
+
+// butterflies j0 <= j < j1 of an inverse transform stage on the block {a,2k}
+static inline void _ntt_inv_span(uint64_t *a, size_t k, size_t j0, size_t j1,
+                                 uint64_t p, const uint64_t *w,
+                                 const uint64_t *wq)
+{
+    uint64_t u, v, s;
+    size_t j = j0;
+    if (j == 0 and j < j1) // r^0 = 1
+    {
+        u = a[0], v = a[k];
+        s = u + v;
+        a[0] = s - (s >= p)*p;
+        s = u - v + p;
+        a[k] = s - (s >= p)*p;
+        ++j;
+    }
+    for (; j < j1; ++j)
+    {
+        // v = -a[j+k]*r^-j
+        u = a[j];
+        v = _shoup_mulmod(a[j+k],w[2*k-j],wq[2*k-j],p);
+        s = u - v + p;
+        a[j] = s - (s >= p)*p;
+        s = u + v;
+        a[j+k] = s - (s >= p)*p;
+    }
+}
+
+// _ntt_fwd using up to threads threads, the first stage is split among the
+// threads and then the 2 halves are independent transforms of length n/2
+static void _ntt_fwd_mt(uint64_t *a, size_t n, uint64_t p,
+                        const uint64_t *w, const uint64_t *wq,
+                        unsigned threads)
+{
+    if (threads <= 1 or n < U64ARR_LL_MT_TRANSFORM_LEN)
+    {
+        _ntt_fwd(a,n,p,w,wq);
+        return;
+    }
+    size_t k = n/2;
+    _run_ranges(k,threads,[&](size_t j0, size_t j1)
+    {
+        _ntt_fwd_span(a,k,j0,j1,p,w,wq);
+    });
+    _run_tasks(2,threads,[&](size_t i)
+    {
+        _ntt_fwd_mt(a+i*k,k,p,w,wq,_task_threads(2,threads,i));
+    });
+}
+
+// _ntt_inv using up to threads threads (reverse order of _ntt_fwd_mt)
+static void _ntt_inv_mt(uint64_t *a, size_t n, uint64_t p,
+                        const uint64_t *w, const uint64_t *wq,
+                        unsigned threads)
+{
+    if (threads <= 1 or n < U64ARR_LL_MT_TRANSFORM_LEN)
+    {
+        _ntt_inv(a,n,p,w,wq);
+        return;
+    }
+    size_t k = n/2;
+    _run_tasks(2,threads,[&](size_t i)
+    {
+        _ntt_inv_mt(a+i*k,k,p,w,wq,_task_threads(2,threads,i));
+    });
+    _run_ranges(k,threads,[&](size_t j0, size_t j1)
+    {
+        _ntt_inv_span(a,k,j0,j1,p,w,wq);
+    });
+}
+
+// combine residues a[k][i] modulo _ntt_p[k] for i0 <= i < i1 into
+// {z+i0,i1-i0} and the 2 limbs above that in hi (the combined coefficient i
+// is added in at limb position i as in a convolution result)
+static void _ntt_crt(uint64_t *const a[3], size_t i0, size_t i1,
+                     uint64_t *z, uint64_t *hi)
+{
+    const uint64_t p0 = _ntt_p[0], p1 = _ntt_p[1], p2 = _ntt_p[2];
+    // constants for garner's algorithm
+    const uint64_t i01 = _powmod(p0%p1,p1-2,p1); // 1/p0 mod p1
+    const uint64_t p0m2 = p0%p2, p01m2 = _mulmod(p0m2,p1%p2,p2);
+    const uint64_t i012 = _powmod(p01m2,p2-2,p2); // 1/(p0*p1) mod p2
+    uint64_t p01_0, p01_1; // p0*p1
+    _mul64full(p0,p1,&p01_0,&p01_1);
+    _add128 acc; // sum of coefficients at the current limb position
+    uint64_t v0, v1;
+    for (size_t i = i0; i < i1; ++i)
+    {
+        // c = r0 + p0*k1 + p0*p1*k2 with k1 < p1 and k2 < p2
+        uint64_t r0 = a[0][i], r1 = a[1][i], r2 = a[2][i];
+        uint64_t r0m1 = r0 % p1, r0m2 = r0 % p2;
+        uint64_t k1 = _mulmod(r1 - r0m1 + (r1 < r0m1)*p1,i01,p1);
+        uint64_t y = r0m2 + _mulmod(p0m2,k1,p2); // c - p0*p1*k2 mod p2
+        y = (y % p2);
+        uint64_t k2 = _mulmod(r2 - y + (r2 < y)*p2,i012,p2);
+        acc._add(r0,0);
+        _mul64full(p0,k1,&v0,&v1);
+        acc._add(v0,v1);
+        _mul64full(p01_0,k2,&v0,&v1);
+        acc._add(v0,v1);
+        _mul64full(p01_1,k2,&v0,&v1); // at next limb position
+        acc._u1 += v0;
+        acc._u2 += v1 + (acc._u1 < v0);
+        // output lowest limb and shift
+        z[i] = acc._u0;
+        acc._u0 = acc._u1;
+        acc._u1 = acc._u2;
+        acc._u2 = 0;
+    }
+    hi[0] = acc._u0;
+    hi[1] = acc._u1;
+}
+
+// cyclic convolution of {x,lx} and {y,ly} modulo p = _ntt_p[k] in {a,n}
+// (transform length n, products are not reduced when lx+ly-1 <= n)
+// squares with 2 transforms instead of 3 when x == y
+// requires 3n limbs of scratch space at t
+static void _ntt_conv(const uint64_t *x, size_t lx,
+                      const uint64_t *y, size_t ly, size_t k,
+                      uint64_t *a, size_t n, uint64_t *t, unsigned threads)
+{
+    uint64_t *b = t, *w = t+n, *wq = t+2*n;
+    uint64_t p = _ntt_p[k];
+    _ntt_twiddles(n,p,_ntt_g[k],w,wq);
+    for (size_t i = 0; i < lx; ++i)
+        a[i] = x[i] % p;
+    for (size_t i = lx; i < n; ++i)
+        a[i] = 0;
+    _ntt_fwd_mt(a,n,p,w,wq,threads);
+    if (x == y and lx == ly)
+        b = a;
+    else
+    {
+        for (size_t i = 0; i < ly; ++i)
+            b[i] = y[i] % p;
+        for (size_t i = ly; i < n; ++i)
+            b[i] = 0;
+        _ntt_fwd_mt(b,n,p,w,wq,threads);
+    }
+    // pointwise products, also dividing by n here
+    uint64_t ninv = _powmod(n%p,p-2,p), ninvq = _shoup_pre(ninv,p);
+    _run_ranges(n,threads,[=](size_t i0, size_t i1)
+    {
+        for (size_t i = i0; i < i1; ++i)
+            a[i] = _shoup_mulmod(_mulmod(a[i],b[i],p),ninv,ninvq,p);
+    });
+    _ntt_inv_mt(a,n,p,w,wq,threads);
+}
+
+// NTT multiplication, {z,lx+ly} = {x,lx} * {y,ly}
+// with threads > 1, the 3 primes are done in parallel and the transforms
+// and combining the residues are split among the threads
+// requires 6n limbs of scratch space at t (n = _ntt_len(lx,ly)),
+// or 12n limbs if threads > 1
+static void _mul_ntt(const uint64_t *x, size_t lx,
+                     const uint64_t *y, size_t ly,
+                     uint64_t *z, uint64_t *t, unsigned threads)
+{
+    size_t n = _ntt_len(lx,ly);
+    assert(n <= (1uLL << 54));
+    uint64_t *a[3] = {t, t+n, t+2*n};
+    _run_tasks(3,threads,[&](size_t k)
+    {
+        _ntt_conv(x,lx,y,ly,k,a[k],n,t+3*n + (threads > 1 ? 3*n*k : 0),
+                  _task_threads(3,threads,k));
+    });
+    // combine residues in parts, then add the high limbs of each part
+    size_t l = lx+ly-1, np = std::min((size_t)std::max(threads,1u),l);
+    uint64_t *hi = t+3*n;
+    assert(2*np <= n);
+    _run_tasks(np,threads,[&](size_t i)
+    {
+        _ntt_crt(a,l*i/np,l*(i+1)/np,z,hi+2*i);
+    });
+    z[l] = hi[2*np-2];
+    assert(hi[2*np-1] == 0);
+    for (size_t i = 0; i+1 < np; ++i)
+    {
+        size_t e = l*(i+1)/np;
+        bool o = u64arr_ll_add_to(z+e,l+1-e,hi+2*i,2);
+        assert(!o);
+    }
+}
+
+/*
+floating point FFT multiplication
+the numbers are split into b bit pieces (b <= 16) which are the real and
+imaginary parts of c = a + i*b, then c*c = a*a - b*b + 2*i*a*b is computed
+with a complex FFT of doubles and the imaginary part is rounded to integers
+b is chosen from an a priori error bound so that rounding is provably exact
+the transform uses radix-4 butterflies on separate real and imaginary arrays
+(vectorized with AVX2 and FMA when available)
+*/
+
+// FFT twiddle tables for transforms of length n (power of 2)
+// the radix-4 stage with blocks of 4q values uses 6q doubles, which are the
+// real parts of W^j, then imaginary parts of W^j, W^2j, W^3j for j < q
+// (W = e^(-2*pi*i/4q)), starting at offset _fft_tw_off(n,q)
+static size_t _fft_tw_off(size_t n, size_t q)
+{
+    size_t off = 0;
+    for (size_t k = n/4; k > q; k /= 4)
+        off += 6*k;
+    return off;
+}
+
+// total length of the twiddle tables for transforms of length n
+static size_t _fft_tw_len(size_t n)
+{
+    return _fft_tw_off(n,0);
+}
+
+// smallest power of 2 s with s*s >= n (table size for _fft_twiddles)
+static size_t _fft_twiddles_s(size_t n)
+{
+    size_t s = 1;
+    while (s*s < n)
+        s <<= 1;
+    return s;
+}
+
+// scratch space (limbs) for the long double tables in _fft_twiddles
+// including room to align them
+static size_t _fft_twiddles_itch(size_t n)
+{
+    return (4*_fft_twiddles_s(n)*sizeof(long double)
+            + alignof(long double) + 7) / 8;
+}
+
+// computes the twiddle tables for transforms of length n
+// W_n^m = W_n^(s*(m/s)) * W_n^(m%s) using 2 tables of s >= sqrt(n) values
+// from cosl/sinl, the products are done in long double so the results are
+// within 2^-52 of the exact values
+// requires _fft_twiddles_itch(n) limbs of scratch space at t
+static void _fft_twiddles(size_t n, double *w, uint64_t *t)
+{
+    const long double pi = 3.141592653589793238462643383279502884L;
+    size_t s = _fft_twiddles_s(n);
+    uintptr_t a = reinterpret_cast<uintptr_t>(t);
+    a = (a + alignof(long double) - 1) & ~(uintptr_t)(alignof(long double)-1);
+    long double *lo = reinterpret_cast<long double*>(a), *hi = lo+2*s;
+    for (size_t i = 0; i < s; ++i)
+    {
+        long double a = -2*pi*(long double)i/(long double)n;
+        lo[2*i] = cosl(a);
+        lo[2*i+1] = sinl(a);
+        a = -2*pi*(long double)(i*s)/(long double)n;
+        hi[2*i] = cosl(a);
+        hi[2*i+1] = sinl(a);
+    }
+    for (size_t q = n/4; q; q /= 4)
+    {
+        double *wq = w + _fft_tw_off(n,q);
+        size_t step = n/(4*q); // W_4q = W_n^step
+        for (size_t k = 1; k <= 3; ++k)
+            for (size_t j = 0; j < q; ++j)
+            {
+                size_t m = k*j*step, l = m%s, h = m/s;
+                long double cr = hi[2*h]*lo[2*l] - hi[2*h+1]*lo[2*l+1];
+                long double ci = hi[2*h]*lo[2*l+1] + hi[2*h+1]*lo[2*l];
+                wq[(2*k-2)*q+j] = (double)cr;
+                wq[(2*k-1)*q+j] = (double)ci;
+            }
+    }
+}
+
+// butterflies j0 <= j < j1 of _fft_fwd4 on the block {re,4q} + i*{im,4q}
+static inline void _fft_fwd4_span(double *re, double *im, size_t q,
+                                 const double *w, size_t j0, size_t j1)
+{
+    const double *w1r = w, *w1i = w+q, *w2r = w+2*q, *w2i = w+3*q;
+    const double *w3r = w+4*q, *w3i = w+5*q;
+    double *r0 = re, *r1 = r0+q, *r2 = r1+q, *r3 = r2+q;
+    double *i0 = im, *i1 = i0+q, *i2 = i1+q, *i3 = i2+q;
+    size_t j = j0;
+#if defined(__AVX2__) and defined(__FMA__)
+    for (; j+4 <= j1; j += 4)
+    {
+        __m256d a0r = _mm256_loadu_pd(r0+j), a0i = _mm256_loadu_pd(i0+j);
+        __m256d a1r = _mm256_loadu_pd(r1+j), a1i = _mm256_loadu_pd(i1+j);
+        __m256d a2r = _mm256_loadu_pd(r2+j), a2i = _mm256_loadu_pd(i2+j);
+        __m256d a3r = _mm256_loadu_pd(r3+j), a3i = _mm256_loadu_pd(i3+j);
+        __m256d t0r = _mm256_add_pd(a0r,a2r), t0i = _mm256_add_pd(a0i,a2i);
+        __m256d t1r = _mm256_sub_pd(a0r,a2r), t1i = _mm256_sub_pd(a0i,a2i);
+        __m256d t2r = _mm256_add_pd(a1r,a3r), t2i = _mm256_add_pd(a1i,a3i);
+        __m256d t3r = _mm256_sub_pd(a1r,a3r), t3i = _mm256_sub_pd(a1i,a3i);
+        _mm256_storeu_pd(r0+j,_mm256_add_pd(t0r,t2r));
+        _mm256_storeu_pd(i0+j,_mm256_add_pd(t0i,t2i));
+        __m256d s1r = _mm256_add_pd(t1r,t3i), s1i = _mm256_sub_pd(t1i,t3r);
+        __m256d s2r = _mm256_sub_pd(t0r,t2r), s2i = _mm256_sub_pd(t0i,t2i);
+        __m256d s3r = _mm256_sub_pd(t1r,t3i), s3i = _mm256_add_pd(t1i,t3r);
+        __m256d cr, ci;
+        cr = _mm256_loadu_pd(w1r+j), ci = _mm256_loadu_pd(w1i+j);
+        _mm256_storeu_pd(r1+j,_mm256_fmsub_pd(s1r,cr,_mm256_mul_pd(s1i,ci)));
+        _mm256_storeu_pd(i1+j,_mm256_fmadd_pd(s1r,ci,_mm256_mul_pd(s1i,cr)));
+        cr = _mm256_loadu_pd(w2r+j), ci = _mm256_loadu_pd(w2i+j);
+        _mm256_storeu_pd(r2+j,_mm256_fmsub_pd(s2r,cr,_mm256_mul_pd(s2i,ci)));
+        _mm256_storeu_pd(i2+j,_mm256_fmadd_pd(s2r,ci,_mm256_mul_pd(s2i,cr)));
+        cr = _mm256_loadu_pd(w3r+j), ci = _mm256_loadu_pd(w3i+j);
+        _mm256_storeu_pd(r3+j,_mm256_fmsub_pd(s3r,cr,_mm256_mul_pd(s3i,ci)));
+        _mm256_storeu_pd(i3+j,_mm256_fmadd_pd(s3r,ci,_mm256_mul_pd(s3i,cr)));
+    }
+#endif
+    for (; j < j1; ++j)
+    {
+        double t0r = r0[j]+r2[j], t0i = i0[j]+i2[j];
+        double t1r = r0[j]-r2[j], t1i = i0[j]-i2[j];
+        double t2r = r1[j]+r3[j], t2i = i1[j]+i3[j];
+        double t3r = r1[j]-r3[j], t3i = i1[j]-i3[j];
+        r0[j] = t0r+t2r;
+        i0[j] = t0i+t2i;
+        double s1r = t1r+t3i, s1i = t1i-t3r;
+        double s2r = t0r-t2r, s2i = t0i-t2i;
+        double s3r = t1r-t3i, s3i = t1i+t3r;
+        r1[j] = s1r*w1r[j] - s1i*w1i[j];
+        i1[j] = s1r*w1i[j] + s1i*w1r[j];
+        r2[j] = s2r*w2r[j] - s2i*w2i[j];
+        i2[j] = s2r*w2i[j] + s2i*w2r[j];
+        r3[j] = s3r*w3r[j] - s3i*w3i[j];
+        i3[j] = s3r*w3i[j] + s3i*w3r[j];
+    }
+}
+
+// radix-4 decimation in frequency stage of the forward transform
+// with s = (x0-x2) - i*(x1-x3), each block of 4q values becomes
+// {x0+x1+x2+x3, s*W^j, (x0-x1+x2-x3)*W^2j, conj(s')*W^3j}
+// where s' = (x0-x2) + i*(x1-x3) (this is how digit reversal arises)
+static void _fft_fwd4(double *re, double *im, size_t n, size_t q,
+                      const double *w)
+{
+    for (size_t i = 0; i < n; i += 4*q)
+        _fft_fwd4_span(re+i,im+i,q,w,0,q);
+}
+
+// butterflies j0 <= j < j1 of _fft_inv4 on the block {re,4q} + i*{im,4q}
+static inline void _fft_inv4_span(double *re, double *im, size_t q,
+                                 const double *w, size_t j0, size_t j1)
+{
+    const double *w1r = w, *w1i = w+q, *w2r = w+2*q, *w2i = w+3*q;
+    const double *w3r = w+4*q, *w3i = w+5*q;
+    double *r0 = re, *r1 = r0+q, *r2 = r1+q, *r3 = r2+q;
+    double *i0 = im, *i1 = i0+q, *i2 = i1+q, *i3 = i2+q;
+    size_t j = j0;
+#if defined(__AVX2__) and defined(__FMA__)
+    for (; j+4 <= j1; j += 4)
+    {
+        __m256d s0r = _mm256_loadu_pd(r0+j), s0i = _mm256_loadu_pd(i0+j);
+        __m256d ar, ai, cr, ci;
+        ar = _mm256_loadu_pd(r1+j), ai = _mm256_loadu_pd(i1+j);
+        cr = _mm256_loadu_pd(w1r+j), ci = _mm256_loadu_pd(w1i+j);
+        __m256d s1r = _mm256_fmadd_pd(ar,cr,_mm256_mul_pd(ai,ci));
+        __m256d s1i = _mm256_fmsub_pd(ai,cr,_mm256_mul_pd(ar,ci));
+        ar = _mm256_loadu_pd(r2+j), ai = _mm256_loadu_pd(i2+j);
+        cr = _mm256_loadu_pd(w2r+j), ci = _mm256_loadu_pd(w2i+j);
+        __m256d s2r = _mm256_fmadd_pd(ar,cr,_mm256_mul_pd(ai,ci));
+        __m256d s2i = _mm256_fmsub_pd(ai,cr,_mm256_mul_pd(ar,ci));
+        ar = _mm256_loadu_pd(r3+j), ai = _mm256_loadu_pd(i3+j);
+        cr = _mm256_loadu_pd(w3r+j), ci = _mm256_loadu_pd(w3i+j);
+        __m256d s3r = _mm256_fmadd_pd(ar,cr,_mm256_mul_pd(ai,ci));
+        __m256d s3i = _mm256_fmsub_pd(ai,cr,_mm256_mul_pd(ar,ci));
+        __m256d tar = _mm256_add_pd(s0r,s2r), tai = _mm256_add_pd(s0i,s2i);
+        __m256d tbr = _mm256_sub_pd(s0r,s2r), tbi = _mm256_sub_pd(s0i,s2i);
+        __m256d tcr = _mm256_add_pd(s1r,s3r), tci = _mm256_add_pd(s1i,s3i);
+        __m256d tdr = _mm256_sub_pd(s1r,s3r), tdi = _mm256_sub_pd(s1i,s3i);
+        _mm256_storeu_pd(r0+j,_mm256_add_pd(tar,tcr));
+        _mm256_storeu_pd(i0+j,_mm256_add_pd(tai,tci));
+        _mm256_storeu_pd(r2+j,_mm256_sub_pd(tar,tcr));
+        _mm256_storeu_pd(i2+j,_mm256_sub_pd(tai,tci));
+        _mm256_storeu_pd(r1+j,_mm256_sub_pd(tbr,tdi));
+        _mm256_storeu_pd(i1+j,_mm256_add_pd(tbi,tdr));
+        _mm256_storeu_pd(r3+j,_mm256_add_pd(tbr,tdi));
+        _mm256_storeu_pd(i3+j,_mm256_sub_pd(tbi,tdr));
+    }
+#endif
+    for (; j < j1; ++j)
+    {
+        double s0r = r0[j], s0i = i0[j];
+        double s1r = r1[j]*w1r[j] + i1[j]*w1i[j];
+        double s1i = i1[j]*w1r[j] - r1[j]*w1i[j];
+        double s2r = r2[j]*w2r[j] + i2[j]*w2i[j];
+        double s2i = i2[j]*w2r[j] - r2[j]*w2i[j];
+        double s3r = r3[j]*w3r[j] + i3[j]*w3i[j];
+        double s3i = i3[j]*w3r[j] - r3[j]*w3i[j];
+        double tar = s0r+s2r, tai = s0i+s2i;
+        double tbr = s0r-s2r, tbi = s0i-s2i;
+        double tcr = s1r+s3r, tci = s1i+s3i;
+        double tdr = s1r-s3r, tdi = s1i-s3i;
+        r0[j] = tar+tcr;
+        i0[j] = tai+tci;
+        r2[j] = tar-tcr;
+        i2[j] = tai-tci;
+        r1[j] = tbr-tdi;
+        i1[j] = tbi+tdr;
+        r3[j] = tbr+tdi;
+        i3[j] = tbi-tdr;
+    }
+}
+
+// radix-4 decimation in time stage of the inverse transform
+// undoes _fft_fwd4 (up to a factor of 4) using the conjugate twiddles
+static void _fft_inv4(double *re, double *im, size_t n, size_t q,
+                      const double *w)
+{
+    for (size_t i = 0; i < n; i += 4*q)
+        _fft_inv4_span(re+i,im+i,q,w,0,q);
+}
+
+// radix-2 stage on blocks of 2 values, used when n is not a power of 4
+static void _fft_2(double *re, double *im, size_t n)
+{
+    for (size_t i = 0; i < n; i += 2)
+    {
+        double ar = re[i], ai = im[i];
+        re[i] = ar+re[i+1];
+        im[i] = ai+im[i+1];
+        re[i+1] = ar-re[i+1];
+        im[i+1] = ai-im[i+1];
+    }
+}
+
+// forward transform of the block {re,m} + i*{im,m} which is part of a
+// transform of length n, output is in digit reversed order
+// large blocks are done depth first so the small stages stay in cache,
+// the first stage is split among up to threads threads and then the 4
+// quarters are independent blocks which are done in parallel
+static void _fft_fwd(double *re, double *im, size_t n, size_t m,
+                     const double *w, unsigned threads)
+{
+    if (m > U64ARR_LL_FFT_BLOCK)
+    {
+        size_t q = m/4;
+        const double *wq = w+_fft_tw_off(n,q);
+        if (m < U64ARR_LL_MT_TRANSFORM_LEN)
+            threads = 1;
+        _run_ranges(q,threads,[&](size_t j0, size_t j1)
+        {
+            _fft_fwd4_span(re,im,q,wq,j0,j1);
+        });
+        _run_tasks(4,threads,[&](size_t k)
+        {
+            _fft_fwd(re+k*q,im+k*q,n,q,w,_task_threads(4,threads,k));
+        });
+        return;
+    }
+    for (size_t q = m/4; q; q /= 4)
+        _fft_fwd4(re,im,m,q,w+_fft_tw_off(n,q));
+    if (m > 1 and !(m & 0x5555555555555555uLL)) // odd power of 2
+        _fft_2(re,im,m);
+}
+
+// inverse of _fft_fwd without the division by m
+static void _fft_inv(double *re, double *im, size_t n, size_t m,
+                     const double *w, unsigned threads)
+{
+    if (m > U64ARR_LL_FFT_BLOCK)
+    {
+        size_t q = m/4;
+        const double *wq = w+_fft_tw_off(n,q);
+        if (m < U64ARR_LL_MT_TRANSFORM_LEN)
+            threads = 1;
+        _run_tasks(4,threads,[&](size_t k)
+        {
+            _fft_inv(re+k*q,im+k*q,n,q,w,_task_threads(4,threads,k));
+        });
+        _run_ranges(q,threads,[&](size_t j0, size_t j1)
+        {
+            _fft_inv4_span(re,im,q,wq,j0,j1);
+        });
+        return;
+    }
+    size_t q = 1; // smallest radix-4 stage
+    if (m > 1 and !(m & 0x5555555555555555uLL)) // odd power of 2
+    {
+        _fft_2(re,im,m);
+        q = 2;
+    }
+    for (; 4*q <= m; q *= 4)
+        _fft_inv4(re,im,m,q,w+_fft_tw_off(n,q));
+}
+
+// piece width (bits) for FFT multiplication of {x,lx} * {y,ly} and the
+// transform length (stored in *np), this is the largest width <= 16 for
+// which rounding the result is provably exact, or 0 if that is less than
+// U64ARR_LL_MUL_FFT_MIN_BITS
+// for a transform of length 2^k with doubles (precision e = 2^-53) and
+// twiddle factors with error at most b, the error of each coefficient of a
+// convolution is at most (percival, also brent and zimmermann, modern
+// computer arithmetic, theorem 3.3.2)
+//   |a|*|b|*((1+e)^3k * (1+e*sqrt(5))^(3k+1) * (1+b)^3k - 1)
+// where a = b = c here, |c| <= sqrt(pieces)*(2^bits-1) is its euclidean norm
+// the radix-4 stages do no more rounding per level than the radix-2
+// transform this bound is for, and 1/2n is applied exactly
+static unsigned _fft_bits(size_t lx, size_t ly, size_t *np)
+{
+    const double e = ldexp(1.0,-53), beta = ldexp(1.0,-52);
+    for (unsigned b = 16; b >= U64ARR_LL_MUL_FFT_MIN_BITS; --b)
+    {
+        size_t px = (64*lx+b-1)/b, py = (64*ly+b-1)/b;
+        size_t n = 1, k = 0;
+        while (n < px+py-1)
+        {
+            n <<= 1;
+            ++k;
+        }
+        double m = ldexp(1.0,b) - 1;
+        double norms = (double)(px+py)*m*m;
+        // (1+x)^j <= exp(j*x), with some margin for rounding here
+        double f = expm1(3*k*e + (3*k+1)*sqrt(5.0)*e + 3*k*beta);
+        if (norms*f*1.01 < 0.5)
+        {
+            *np = n;
+            return b;
+        }
+    }
+    return 0;
+}
+
+// split {x,lx} into pieces of b bits {re,n} (zero padded)
+static void _fft_split(const uint64_t *x, size_t lx, unsigned b,
+                       double *re, size_t n)
+{
+    uint64_t mask = (1uLL << b) - 1;
+    size_t px = (64*lx+b-1)/b;
+    for (size_t k = 0; k < px; ++k)
+    {
+        size_t bit = k*b, i = bit/64;
+        unsigned o = bit%64;
+        uint64_t v = x[i] >> o;
+        if (o+b > 64 and i+1 < lx)
+            v |= x[i+1] << (64-o);
+        re[k] = (double)(v & mask);
+    }
+    for (size_t k = px; k < n; ++k)
+        re[k] = 0.0;
+}
+
+// round the coefficients {re,l} and add them at offsets of b bits to make
+// {z,lz}, returns the largest distance from a coefficient to its rounding
+static double _fft_join(const double *re, size_t l, unsigned b,
+                        uint64_t *z, size_t lz)
+{
+    uint64_t mask = (1uLL << b) - 1, c = 0;
+    double err = 0.0;
+    for (size_t i = 0; i < lz; ++i)
+        z[i] = 0;
+    for (size_t k = 0; k < l or c; ++k)
+    {
+        if (k < l)
+        {
+            double r = nearbyint(re[k]);
+            err = std::max(err,fabs(re[k]-r));
+            c += (uint64_t)(r < 0.0 ? 0.0 : r);
+        }
+        // write the lowest b bits of the carry
+        size_t bit = k*b, i = bit/64;
+        unsigned o = bit%64;
+        if (i >= lz)
+            break;
+        uint64_t d = c & mask;
+        z[i] |= d << o;
+        if (o+b > 64 and i+1 < lz)
+            z[i+1] |= d >> (64-o);
+        c >>= b;
+    }
+    return err;
+}
+
+// FFT multiplication, {z,lx+ly} = {x,lx} * {y,ly}
+// the result is checked by how close the coefficients are to integers
+// and recomputed with _mul_ntt if that fails (should never happen)
+// the transforms are split among up to threads threads
+// requires _fft_bits(lx,ly,&n) > 0
+// requires _mul_itch(lx,ly) limbs of scratch space at t
+static void _mul_fft(const uint64_t *x, size_t lx,
+                     const uint64_t *y, size_t ly,
+                     uint64_t *z, uint64_t *t, unsigned threads)
+{
+    size_t n;
+    unsigned b = _fft_bits(lx,ly,&n);
+    assert(b);
+    // the scratch space is used as doubles
+    double *re = reinterpret_cast<double*>(t), *im = re+n, *w = im+n;
+    _fft_twiddles(n,w,reinterpret_cast<uint64_t*>(w+_fft_tw_len(n)));
+    _fft_split(x,lx,b,re,n);
+    _fft_split(y,ly,b,im,n);
+    _fft_fwd(re,im,n,n,w,threads);
+    // pointwise squares and division by 2n (exact)
+    double s = 0.5/(double)n;
+    _run_ranges(n,threads,[&](size_t i0, size_t i1)
+    {
+        for (size_t i = i0; i < i1; ++i)
+        {
+            double r = re[i], m = im[i];
+            re[i] = (r*r - m*m)*s;
+            im[i] = 2.0*r*m*s;
+        }
+    });
+    _fft_inv(re,im,n,n,w,threads);
+    size_t l = (64*lx+b-1)/b + (64*ly+b-1)/b - 1;
+    if (_fft_join(im,l,b,z,lx+ly) > 0.25)
+        _mul_ntt(x,lx,y,ly,z,t,1);
+}
+
+static void _mul(const uint64_t *x, size_t lx,
+                 const uint64_t *y, size_t ly, uint64_t *z, uint64_t *t);
+static void _sqr(const uint64_t *x, size_t l, uint64_t *z, uint64_t *t);
+
+// multiplication algorithms selected by _mul_alg
+enum _mul_alg_t
+{
+    _MUL_BASECASE,
+    _MUL_UNBALANCED,
+    _MUL_KARATSUBA,
+    _MUL_TOOM3,
+    _MUL_TOOM4,
+    _MUL_FFT,
+    _MUL_NTT
+};
+
+// choose the multiplication algorithm for {x,lx} * {y,ly}, requires lx >= ly
+static _mul_alg_t _mul_alg(size_t lx, size_t ly)
+{
+    assert(lx >= ly);
+    if (ly < U64ARR_LL_MUL_KARATSUBA_THRESHOLD)
+        return _MUL_BASECASE;
+    // the transform length follows lx+ly so unbalanced sizes cost nothing
+    size_t n;
+    if (ly >= U64ARR_LL_MUL_FFT_THRESHOLD and _fft_bits(lx,ly,&n))
+        return _MUL_FFT;
+    if (ly >= U64ARR_LL_MUL_NTT_THRESHOLD)
+        return _MUL_NTT;
+    if (ly <= (lx+1)/2)
+        return _MUL_UNBALANCED;
+    // toom-k needs every operand to have a nonempty highest part
+    if (ly >= U64ARR_LL_MUL_TOOM4_THRESHOLD and ly > 3*((lx+3)/4))
+        return _MUL_TOOM4;
+    if (ly >= U64ARR_LL_MUL_TOOM3_THRESHOLD and ly > 2*((lx+2)/3))
+        return _MUL_TOOM3;
+    return _MUL_KARATSUBA;
+}
+
+// scratch space (limbs) needed by _mul for {x,lx} * {y,ly}
+static size_t _mul_itch(size_t lx, size_t ly)
+{
+    if (lx < ly)
+        std::swap(lx,ly);
+    size_t h, m, L;
+    switch (_mul_alg(lx,ly))
+    {
+    case _MUL_BASECASE:
+        return 0;
+    case _MUL_UNBALANCED: // see _mul_unbalanced
+        return 2*ly + std::max(_mul_itch(ly,ly),
+                               lx%ly ? _mul_itch(lx%ly,ly) : 0);
+    case _MUL_KARATSUBA: // see _mul_karatsuba
+        h = (lx+1)/2;
+        return std::max(4*h + std::max(_mul_itch(h,h),(size_t)1),
+                        2*h + _mul_itch(lx-h,ly-h));
+    case _MUL_TOOM3: // see _mul_toom3
+        m = (lx+2)/3;
+        L = 2*m+2;
+        return 6*L + std::max({_mul_itch(m+1,m+1),_mul_itch(m,m),
+                               _mul_itch(lx-2*m,ly-2*m)});
+    case _MUL_TOOM4: // see _mul_toom4
+        m = (lx+3)/4;
+        L = 2*m+2;
+        return 10*L + std::max({_mul_itch(m+1,m+1),_mul_itch(m,m),
+                                _mul_itch(lx-3*m,ly-3*m)});
+    case _MUL_FFT: // see _mul_fft, may fall back to _mul_ntt
+        _fft_bits(lx,ly,&m);
+        return std::max(2*m + _fft_tw_len(m) + _fft_twiddles_itch(m),
+                        6*_ntt_len(lx,ly));
+    case _MUL_NTT: // see _mul_ntt
+        return 6*_ntt_len(lx,ly);
+    }
+    assert(0);
+    return 0;
+}
+
+// {z,lx+ly} = {x,lx} * {y,ly} when ly <= (lx+1)/2
+// slices {x,lx} into pieces of ly limbs (and a shorter last piece) which are
+// each multiplied by {y,ly} with a balanced algorithm and accumulated in z
+// so the cost is about lx/ly balanced products of ly limbs
+// requires _mul_itch(lx,ly) limbs of scratch space at t
+static void _mul_unbalanced(const uint64_t *x, size_t lx,
+                            const uint64_t *y, size_t ly,
+                            uint64_t *z, uint64_t *t)
+{
+    assert(2*ly <= lx+1);
+    _mul(x,ly,y,ly,z,t);
+    // z has the product of the first i limbs of x in {z,i+ly}
+    uint64_t *p = t, *u = t+2*ly;
+    for (size_t i = ly; i < lx; i += ly)
+    {
+        size_t c = std::min(ly,lx-i);
+        _mul(x+i,c,y,ly,p,u);
+        // the high part of p is past the end of z so far
+        for (size_t j = ly; j < c+ly; ++j)
+            z[i+j] = p[j];
+        bool o = u64arr_ll_add_to(z+i,c+ly,p,ly);
+        assert(!o);
+    }
+}
+
+// finish karatsuba multiplication of {x,lx} * {y,ly} split at h limbs
+// with x0*y0 in {z,2h}, x1*y1 in {z+2h,lx+ly-2h} and |x0-x1|*|y0-y1| in
+// {d,2h} where neg is the sign of (x0-x1)*(y0-y1)
+// requires 2h+1 limbs of scratch space at m
+static void _karatsuba_finish(uint64_t *z, size_t lx, size_t ly, size_t h,
+                              const uint64_t *d, bool neg, uint64_t *m)
+{
+    // {m,2h+1} = x0*y0 + x1*y1 - (x0-x1)*(y0-y1)
+    m[2*h] = u64arr_ll_add(z,2*h,z+2*h,lx+ly-2*h,m);
+    bool o;
+    if (neg)
+        o = u64arr_ll_add_to(m,2*h+1,d,2*h);
+    else
+        o = u64arr_ll_sub_from(m,2*h+1,d,2*h);
+    assert(!o);
+    // middle term fits in lx+ly-h limbs so any limbs past that are zero
+    size_t lm = std::min(2*h+1,lx+ly-h);
+    o = u64arr_ll_add_to(z+h,lx+ly-h,m,lm);
+    assert(!o);
+}
+
+// karatsuba multiplication, {z,lx+ly} = {x,lx} * {y,ly}
+// split x = x0 + x1*B^h and y = y0 + y1*B^h (B = 2^64)
+// x*y = x0*y0 + (x0*y0 + x1*y1 - (x0-x1)*(y0-y1))*B^h + x1*y1*B^2h
+// requires lx >= ly > (lx+1)/2
+// requires _mul_itch(lx,ly) limbs of scratch space at t
+static void _mul_karatsuba(const uint64_t *x, size_t lx,
+                           const uint64_t *y, size_t ly,
+                           uint64_t *z, uint64_t *t)
+{
+    size_t h = (lx+1)/2;
+    size_t hx = lx-h, hy = ly-h; // lengths of x1 and y1
+    assert(lx >= ly and ly > h);
+    // {t,2h} = |x0-x1| * |y0-y1|
+    uint64_t *dx = t+2*h, *dy = t+3*h;
+    bool neg = _sub_abs(x,h,x+h,hx,dx) != _sub_abs(y,h,y+h,hy,dy);
+    _mul(dx,h,dy,h,t,t+4*h);
+    // x0*y0 and x1*y1 go directly in z
+    _mul(x,h,y,h,z,t+2*h);
+    _mul(x+h,hx,y+h,hy,z+2*h,t+2*h);
+    _karatsuba_finish(z,lx,ly,h,t,neg,t+2*h);
+}
+
+// add the coefficient {c,lc} into {z,lz} at limb offset k
+// the sum must fit in lz limbs so limbs of c past lz-k are zero
+static inline void _add_coef(uint64_t *z, size_t lz, size_t k,
+                             const uint64_t *c, size_t lc)
+{
+    bool o = u64arr_ll_add_to(z+k,lz-k,c,std::min(lc,lz-k));
+    assert(!o);
+}
+
+// evaluate x = x0 + x1*X + x2*X^2 (parts of m limbs) at X = 1, -1, 2
+// results have m+1 limbs, the value at -1 is stored as an absolute value
+// returns true if the value at -1 is negative
+static bool _toom3_eval(const uint64_t *x, size_t lx, size_t m,
+                        uint64_t *p1, uint64_t *m1, uint64_t *p2)
+{
+    const uint64_t *x0 = x, *x1 = x+m, *x2 = x+2*m;
+    size_t l2 = lx-2*m;
+    bool o;
+    // x0+x2 then x0-x1+x2 and x0+x1+x2
+    p1[m] = u64arr_ll_add(x0,m,x2,l2,p1);
+    bool neg = _sub_abs(p1,m+1,x1,m,m1);
+    o = u64arr_ll_add_to(p1,m+1,x1,m);
+    assert(!o);
+    // x0+2*x1+4*x2 by horner's method
+    _copy_pad(x2,l2,p2,m+1);
+    _shl(p2,m+1,1);
+    o = u64arr_ll_add_to(p2,m+1,x1,m);
+    assert(!o);
+    _shl(p2,m+1,1);
+    o = u64arr_ll_add_to(p2,m+1,x0,m);
+    assert(!o);
+    return neg;
+}
+
+// toom-3 interpolation, {z,lz} = c0 + c1*B^m + c2*B^2m + c3*B^3m + c4*B^4m
+// c0 = v0 in {z,2m} and c4 = vinf in {z+4m,lz-4m} must already be set
+// products at 1, -1, 2 have L = 2m+2 limbs and are overwritten
+// (neg1 is the sign of the product at -1 which is stored as absolute value)
+// with c(X) = c0 + c1*X + ... + c4*X^4, all intermediates are nonnegative
+//   s = (c(1)+c(-1))/2 = c0+c2+c4, d = (c(1)-c(-1))/2 = c1+c3
+//   c2 = s-c0-c4, c3 = ((c(2)-c0-4*c2-16*c4)/2-d)/3, c1 = d-c3
+// requires L limbs of scratch space at t
+static void _toom3_interp(uint64_t *z, size_t lz, size_t m,
+                          uint64_t *v1, uint64_t *vm1, bool neg1,
+                          uint64_t *v2, uint64_t *t)
+{
+    size_t L = 2*m+2;
+    const uint64_t *c0 = z, *c4 = z+4*m;
+    size_t l4 = lz-4*m;
+    bool o;
+    // s and d
+    o = u64arr_ll_add(v1,L,vm1,L,t);
+    assert(!o);
+    o = u64arr_ll_sub_from(v1,L,vm1,L);
+    assert(!o);
+    uint64_t *s = neg1 ? v1 : t, *d = neg1 ? t : v1;
+    _shr(s,L,1);
+    _shr(d,L,1);
+    // c2 (in s)
+    o = u64arr_ll_sub_from(s,L,c0,2*m);
+    o |= u64arr_ll_sub_from(s,L,c4,l4);
+    assert(!o);
+    // c1+4*c3 (in v2), vm1 is used as a temporary
+    o = u64arr_ll_sub_from(v2,L,c0,2*m);
+    _copy_pad(s,L,vm1,L);
+    _shl(vm1,L,2);
+    o |= u64arr_ll_sub_from(v2,L,vm1,L);
+    _copy_pad(c4,l4,vm1,L);
+    _shl(vm1,L,4);
+    o |= u64arr_ll_sub_from(v2,L,vm1,L);
+    assert(!o);
+    _shr(v2,L,1);
+    // c3 (in v2) and c1 (in d)
+    o = u64arr_ll_sub_from(v2,L,d,L);
+    assert(!o);
+    u64arr_ll_divexact_64(v2,L,3);
+    o = u64arr_ll_sub_from(d,L,v2,L);
+    assert(!o);
+    // add c1, c2, c3 between c0 and c4
+    for (size_t i = 2*m; i < 4*m; ++i)
+        z[i] = 0;
+    _add_coef(z,lz,m,d,L);
+    _add_coef(z,lz,2*m,s,L);
+    _add_coef(z,lz,3*m,v2,L);
+}
+
+// toom-3 multiplication, {z,lx+ly} = {x,lx} * {y,ly}
+// splits operands into 3 parts of m = ceil(lx/3) limbs and multiplies
+// the values of the 2 polynomials at 0, 1, -1, 2, infinity
+// requires lx >= ly > 2*m
+// requires _mul_itch(lx,ly) limbs of scratch space at t
+static void _mul_toom3(const uint64_t *x, size_t lx,
+                       const uint64_t *y, size_t ly,
+                       uint64_t *z, uint64_t *t)
+{
+    size_t m = (lx+2)/3, L = 2*m+2;
+    assert(lx >= ly and ly > 2*m);
+    // products at 1, -1, 2, then evaluations (m+1 limbs each)
+    uint64_t *v1 = t, *vm1 = t+L, *v2 = t+2*L, *e = t+3*L, *u = t+6*L;
+    uint64_t *xp1 = e, *xm1 = e+(m+1), *xp2 = e+2*(m+1);
+    uint64_t *yp1 = e+3*(m+1), *ym1 = e+4*(m+1), *yp2 = e+5*(m+1);
+    bool neg = _toom3_eval(x,lx,m,xp1,xm1,xp2)
+            != _toom3_eval(y,ly,m,yp1,ym1,yp2);
+    _mul(xp1,m+1,yp1,m+1,v1,u);
+    _mul(xm1,m+1,ym1,m+1,vm1,u);
+    _mul(xp2,m+1,yp2,m+1,v2,u);
+    // products at 0 and infinity go directly in z
+    _mul(x,m,y,m,z,u);
+    _mul(x+2*m,lx-2*m,y+2*m,ly-2*m,z+4*m,u);
+    _toom3_interp(z,lx+ly,m,v1,vm1,neg,v2,e);
+}
+
+// evaluate x = x0 + x1*X + x2*X^2 + x3*X^3 (parts of m limbs)
+// at X = 1, -1, 2, -2, 1/2 (the value at 1/2 is scaled by 8)
+// results have m+1 limbs, values at -1 and -2 are stored as absolute values
+// sets *neg1 and *neg2 to true if the values at -1 and -2 are negative
+static void _toom4_eval(const uint64_t *x, size_t lx, size_t m,
+                        uint64_t *p1, uint64_t *m1, uint64_t *p2,
+                        uint64_t *m2, uint64_t *ph, bool *neg1, bool *neg2)
+{
+    const uint64_t *x0 = x, *x1 = x+m, *x2 = x+2*m, *x3 = x+3*m;
+    size_t l3 = lx-3*m;
+    bool o;
+    // x0+x2 and x1+x3 (in ph temporarily)
+    p1[m] = u64arr_ll_add(x0,m,x2,m,p1);
+    ph[m] = u64arr_ll_add(x1,m,x3,l3,ph);
+    *neg1 = _sub_abs(p1,m+1,ph,m+1,m1);
+    o = u64arr_ll_add_to(p1,m+1,ph,m+1);
+    assert(!o);
+    // x0+4*x2 and 2*x1+8*x3 (in ph temporarily)
+    _copy_pad(x2,m,p2,m+1);
+    _shl(p2,m+1,2);
+    o = u64arr_ll_add_to(p2,m+1,x0,m);
+    _copy_pad(x3,l3,ph,m+1);
+    _shl(ph,m+1,2);
+    o |= u64arr_ll_add_to(ph,m+1,x1,m);
+    assert(!o);
+    _shl(ph,m+1,1);
+    *neg2 = _sub_abs(p2,m+1,ph,m+1,m2);
+    o = u64arr_ll_add_to(p2,m+1,ph,m+1);
+    assert(!o);
+    // 8*x0+4*x1+2*x2+x3 by horner's method
+    _copy_pad(x0,m,ph,m+1);
+    _shl(ph,m+1,1);
+    o = u64arr_ll_add_to(ph,m+1,x1,m);
+    _shl(ph,m+1,1);
+    o |= u64arr_ll_add_to(ph,m+1,x2,m);
+    _shl(ph,m+1,1);
+    o |= u64arr_ll_add_to(ph,m+1,x3,l3);
+    assert(!o);
+}
+
+// toom-4 interpolation, {z,lz} = c0 + c1*B^m + ... + c6*B^6m
+// c0 = v0 in {z,2m} and c6 = vinf in {z+6m,lz-6m} must already be set
+// products at 1, -1, 2, -2, 1/2 have L = 2m+2 limbs and are overwritten
+// (neg1 and neg2 are signs of products at -1 and -2, stored as absolute value)
+// with c(X) = c0 + c1*X + ... + c6*X^6, all intermediates are nonnegative
+//   e1 = (c(1)+c(-1))/2 = c0+c2+c4+c6, o1 = (c(1)-c(-1))/2 = c1+c3+c5
+//   e2 = (c(2)+c(-2))/2 = c0+4*c2+16*c4+64*c6
+//   o2 = (c(2)-c(-2))/4 = c1+4*c3+16*c5
+//   c4 = ((e2-c0-64*c6) - 4*(e1-c0-c6))/12, c2 = e1-c0-c6-c4
+//   r = (64*c(1/2)-64*c0-16*c2-4*c4-c6)/2 = 16*c1+4*c3+c5
+//   u = (o2-o1)/3 = c3+5*c5, v = (16*o1-r)/3 = 4*c3+5*c5
+//   c3 = (v-u)/3, c5 = (u-c3)/5, c1 = o1-c3-c5
+// requires 2L limbs of scratch space at t
+static void _toom4_interp(uint64_t *z, size_t lz, size_t m,
+                          uint64_t *v1, uint64_t *vm1, bool neg1,
+                          uint64_t *v2, uint64_t *vm2, bool neg2,
+                          uint64_t *vh, uint64_t *t)
+{
+    size_t L = 2*m+2;
+    const uint64_t *c0 = z, *c6 = z+6*m;
+    size_t l6 = lz-6*m;
+    uint64_t *b = t+L; // temporary for shifted values
+    bool o;
+    // e1 and o1
+    o = u64arr_ll_add(v1,L,vm1,L,t);
+    o |= u64arr_ll_sub_from(v1,L,vm1,L);
+    assert(!o);
+    uint64_t *e1 = neg1 ? v1 : t, *o1 = neg1 ? t : v1;
+    _shr(e1,L,1);
+    _shr(o1,L,1);
+    // e2 and o2 (vm1 is no longer needed)
+    o = u64arr_ll_add(v2,L,vm2,L,vm1);
+    o |= u64arr_ll_sub_from(v2,L,vm2,L);
+    assert(!o);
+    uint64_t *e2 = neg2 ? v2 : vm1, *o2 = neg2 ? vm1 : v2;
+    _shr(e2,L,1);
+    _shr(o2,L,2);
+    // c2+c4 (in e1) and 4*c2+16*c4 (in e2)
+    o = u64arr_ll_sub_from(e1,L,c0,2*m);
+    o |= u64arr_ll_sub_from(e1,L,c6,l6);
+    o |= u64arr_ll_sub_from(e2,L,c0,2*m);
+    _copy_pad(c6,l6,b,L);
+    _shl(b,L,6);
+    o |= u64arr_ll_sub_from(e2,L,b,L);
+    assert(!o);
+    // c4 (in e2) and c2 (in e1)
+    _copy_pad(e1,L,b,L);
+    _shl(b,L,2);
+    o = u64arr_ll_sub_from(e2,L,b,L);
+    assert(!o);
+    _shr(e2,L,2);
+    u64arr_ll_divexact_64(e2,L,3);
+    o = u64arr_ll_sub_from(e1,L,e2,L);
+    assert(!o);
+    // r (in vh)
+    _copy_pad(c0,2*m,b,L);
+    _shl(b,L,6);
+    o = u64arr_ll_sub_from(vh,L,b,L);
+    _copy_pad(e1,L,b,L);
+    _shl(b,L,4);
+    o |= u64arr_ll_sub_from(vh,L,b,L);
+    _copy_pad(e2,L,b,L);
+    _shl(b,L,2);
+    o |= u64arr_ll_sub_from(vh,L,b,L);
+    o |= u64arr_ll_sub_from(vh,L,c6,l6);
+    assert(!o);
+    _shr(vh,L,1);
+    // u (in o2) and v (in b)
+    o = u64arr_ll_sub_from(o2,L,o1,L);
+    assert(!o);
+    u64arr_ll_divexact_64(o2,L,3);
+    _copy_pad(o1,L,b,L);
+    _shl(b,L,4);
+    o = u64arr_ll_sub_from(b,L,vh,L);
+    assert(!o);
+    u64arr_ll_divexact_64(b,L,3);
+    // c3 (in b), c5 (in o2), c1 (in o1)
+    o = u64arr_ll_sub_from(b,L,o2,L);
+    assert(!o);
+    u64arr_ll_divexact_64(b,L,3);
+    o = u64arr_ll_sub_from(o2,L,b,L);
+    assert(!o);
+    u64arr_ll_divexact_64(o2,L,5);
+    o = u64arr_ll_sub_from(o1,L,b,L);
+    o |= u64arr_ll_sub_from(o1,L,o2,L);
+    assert(!o);
+    // add c1, ..., c5 between c0 and c6
+    for (size_t i = 2*m; i < 6*m; ++i)
+        z[i] = 0;
+    _add_coef(z,lz,m,o1,L);
+    _add_coef(z,lz,2*m,e1,L);
+    _add_coef(z,lz,3*m,b,L);
+    _add_coef(z,lz,4*m,e2,L);
+    _add_coef(z,lz,5*m,o2,L);
+}
+
+// toom-4 multiplication, {z,lx+ly} = {x,lx} * {y,ly}
+// splits operands into 4 parts of m = ceil(lx/4) limbs and multiplies
+// the values of the 2 polynomials at 0, 1, -1, 2, -2, 1/2, infinity
+// requires lx >= ly > 3*m
+// requires _mul_itch(lx,ly) limbs of scratch space at t
+static void _mul_toom4(const uint64_t *x, size_t lx,
+                       const uint64_t *y, size_t ly,
+                       uint64_t *z, uint64_t *t)
+{
+    size_t m = (lx+3)/4, L = 2*m+2;
+    assert(lx >= ly and ly > 3*m);
+    // products at 1, -1, 2, -2, 1/2, then evaluations (m+1 limbs each)
+    uint64_t *v1 = t, *vm1 = t+L, *v2 = t+2*L, *vm2 = t+3*L, *vh = t+4*L;
+    uint64_t *e = t+5*L, *u = t+10*L;
+    uint64_t *xe = e, *ye = e+5*(m+1);
+    bool xneg1, xneg2, yneg1, yneg2;
+    _toom4_eval(x,lx,m,xe,xe+(m+1),xe+2*(m+1),xe+3*(m+1),xe+4*(m+1),
+                &xneg1,&xneg2);
+    _toom4_eval(y,ly,m,ye,ye+(m+1),ye+2*(m+1),ye+3*(m+1),ye+4*(m+1),
+                &yneg1,&yneg2);
+    for (size_t i = 0; i < 5; ++i)
+        _mul(xe+i*(m+1),m+1,ye+i*(m+1),m+1,t+i*L,u);
+    // products at 0 and infinity go directly in z
+    _mul(x,m,y,m,z,u);
+    _mul(x+3*m,lx-3*m,y+3*m,ly-3*m,z+6*m,u);
+    _toom4_interp(z,lx+ly,m,v1,vm1,xneg1 != yneg1,v2,vm2,xneg2 != yneg2,
+                  vh,e);
+}
+
+// {z,lx+ly} = {x,lx} * {y,ly}, choosing algorithm by operand sizes
+// requires _mul_itch(lx,ly) limbs of scratch space at t
+static void _mul(const uint64_t *x, size_t lx,
+                 const uint64_t *y, size_t ly, uint64_t *z, uint64_t *t)
+{
+    if (lx < ly)
+    {
+        std::swap(x,y);
+        std::swap(lx,ly);
+    }
+    switch (_mul_alg(lx,ly))
+    {
+    case _MUL_BASECASE:
+        _mul_basecase(x,lx,y,ly,z);
+        break;
+    case _MUL_UNBALANCED:
+        _mul_unbalanced(x,lx,y,ly,z,t);
+        break;
+    case _MUL_KARATSUBA:
+        _mul_karatsuba(x,lx,y,ly,z,t);
+        break;
+    case _MUL_TOOM3:
+        _mul_toom3(x,lx,y,ly,z,t);
+        break;
+    case _MUL_TOOM4:
+        _mul_toom4(x,lx,y,ly,z,t);
+        break;
+    case _MUL_FFT:
+        _mul_fft(x,lx,y,ly,z,t,1);
+        break;
+    case _MUL_NTT:
+        _mul_ntt(x,lx,y,ly,z,t,1);
+        break;
+    }
+}
+
+// karatsuba squaring, {z,2l} = {x,l}^2
+// split x = x0 + x1*B^h (B = 2^64)
+// x^2 = x0^2 + (x0^2 + x1^2 - (x0-x1)^2)*B^h + x1^2*B^2h
+// requires l >= 2
+// requires _sqr_itch(l) limbs of scratch space at t
+static void _sqr_karatsuba(const uint64_t *x, size_t l,
+                           uint64_t *z, uint64_t *t)
+{
+    size_t h = (l+1)/2, hx = l-h; // length of x1
+    assert(l > h);
+    // {t,2h} = (x0-x1)^2
+    uint64_t *dx = t+2*h;
+    _sub_abs(x,h,x+h,hx,dx);
+    _sqr(dx,h,t,t+3*h);
+    // x0^2 and x1^2 go directly in z
+    _sqr(x,h,z,t+2*h);
+    _sqr(x+h,hx,z+2*h,t+2*h);
+    // {m,2h+1} = x0^2 + x1^2 - (x0-x1)^2
+    uint64_t *m = t+2*h;
+    m[2*h] = u64arr_ll_add(z,2*h,z+2*h,2*hx,m);
+    bool o = u64arr_ll_sub_from(m,2*h+1,t,2*h);
+    assert(!o);
+    // middle term fits in 2l-h limbs so any limbs past that are zero
+    size_t lm = std::min(2*h+1,2*l-h);
+    o = u64arr_ll_add_to(z+h,2*l-h,m,lm);
+    assert(!o);
+}
+
+// toom-3 squaring, {z,2l} = {x,l}^2
+// like _mul_toom3 with one evaluation, squares are never negative
+// requires l > 2*m where m = ceil(l/3)
+// requires _sqr_itch(l) limbs of scratch space at t
+static void _sqr_toom3(const uint64_t *x, size_t l, uint64_t *z, uint64_t *t)
+{
+    size_t m = (l+2)/3, L = 2*m+2;
+    assert(l > 2*m);
+    // squares at 1, -1, 2, then evaluations (m+1 limbs each)
+    uint64_t *v1 = t, *vm1 = t+L, *v2 = t+2*L, *e = t+3*L, *u = e+3*(m+1);
+    uint64_t *xp1 = e, *xm1 = e+(m+1), *xp2 = e+2*(m+1);
+    _toom3_eval(x,l,m,xp1,xm1,xp2);
+    _sqr(xp1,m+1,v1,u);
+    _sqr(xm1,m+1,vm1,u);
+    _sqr(xp2,m+1,v2,u);
+    // squares at 0 and infinity go directly in z
+    _sqr(x,m,z,u);
+    _sqr(x+2*m,l-2*m,z+4*m,u);
+    _toom3_interp(z,2*l,m,v1,vm1,false,v2,e);
+}
+
+// toom-4 squaring, {z,2l} = {x,l}^2
+// like _mul_toom4 with one evaluation, squares are never negative
+// requires l > 3*m where m = ceil(l/4)
+// requires _sqr_itch(l) limbs of scratch space at t
+static void _sqr_toom4(const uint64_t *x, size_t l, uint64_t *z, uint64_t *t)
+{
+    size_t m = (l+3)/4, L = 2*m+2;
+    assert(l > 3*m);
+    // squares at 1, -1, 2, -2, 1/2, then evaluations (m+1 limbs each)
+    uint64_t *v1 = t, *vm1 = t+L, *v2 = t+2*L, *vm2 = t+3*L, *vh = t+4*L;
+    uint64_t *e = t+5*L, *u = e+5*(m+1);
+    bool neg1, neg2;
+    _toom4_eval(x,l,m,e,e+(m+1),e+2*(m+1),e+3*(m+1),e+4*(m+1),&neg1,&neg2);
+    for (size_t i = 0; i < 5; ++i)
+        _sqr(e+i*(m+1),m+1,t+i*L,u);
+    // squares at 0 and infinity go directly in z
+    _sqr(x,m,z,u);
+    _sqr(x+3*m,l-3*m,z+6*m,u);
+    _toom4_interp(z,2*l,m,v1,vm1,false,v2,vm2,false,vh,e);
+}
+
+// choose the squaring algorithm for {x,l}
+// _mul_fft and _mul_ntt handle squaring themselves when x == y
+static _mul_alg_t _sqr_alg(size_t l)
+{
+    if (l < U64ARR_LL_SQR_KARATSUBA_THRESHOLD)
+        return _MUL_BASECASE;
+    _mul_alg_t alg = _mul_alg(l,l);
+    if (alg == _MUL_BASECASE)
+        return l < 2 ? _MUL_BASECASE : _MUL_KARATSUBA;
+    if ((alg == _MUL_FFT or alg == _MUL_NTT)
+            and l < U64ARR_LL_SQR_FFT_THRESHOLD)
+    {
+        if (l >= U64ARR_LL_MUL_TOOM4_THRESHOLD and l > 3*((l+3)/4))
+            return _MUL_TOOM4;
+        if (l >= U64ARR_LL_MUL_TOOM3_THRESHOLD and l > 2*((l+2)/3))
+            return _MUL_TOOM3;
+        return _MUL_KARATSUBA;
+    }
+    return alg;
+}
+
+// scratch space (limbs) needed by _sqr for {x,l}
+static size_t _sqr_itch(size_t l)
+{
+    size_t h, m, L;
+    switch (_sqr_alg(l))
+    {
+    case _MUL_BASECASE:
+        return 0;
+    case _MUL_KARATSUBA: // see _sqr_karatsuba
+        h = (l+1)/2;
+        return std::max({3*h + _sqr_itch(h),4*h+1,2*h + _sqr_itch(l-h)});
+    case _MUL_TOOM3: // see _sqr_toom3
+        m = (l+2)/3;
+        L = 2*m+2;
+        return 3*L + 3*(m+1) + std::max({_sqr_itch(m+1),_sqr_itch(m),
+                                         _sqr_itch(l-2*m)});
+    case _MUL_TOOM4: // see _sqr_toom4
+        m = (l+3)/4;
+        L = 2*m+2;
+        return 5*L + 5*(m+1) + std::max({_sqr_itch(m+1),_sqr_itch(m),
+                                         _sqr_itch(l-3*m)});
+    case _MUL_FFT:
+    case _MUL_NTT:
+        return _mul_itch(l,l);
+    case _MUL_UNBALANCED:
+        break;
+    }
+    assert(0);
+    return 0;
+}
+
+// {z,2l} = {x,l}^2, choosing algorithm by operand size
+// requires _sqr_itch(l) limbs of scratch space at t
+static void _sqr(const uint64_t *x, size_t l, uint64_t *z, uint64_t *t)
+{
+    switch (_sqr_alg(l))
+    {
+    case _MUL_BASECASE:
+        _sqr_basecase(x,l,z);
+        break;
+    case _MUL_KARATSUBA:
+        _sqr_karatsuba(x,l,z,t);
+        break;
+    case _MUL_TOOM3:
+        _sqr_toom3(x,l,z,t);
+        break;
+    case _MUL_TOOM4:
+        _sqr_toom4(x,l,z,t);
+        break;
+    case _MUL_FFT:
+        _mul_fft(x,l,x,l,z,t,1);
+        break;
+    case _MUL_NTT:
+        _mul_ntt(x,l,x,l,z,t,1);
+        break;
+    case _MUL_UNBALANCED:
+        assert(0);
+    }
+}
+
+size_t u64arr_ll_sqr_itch(size_t l)
+{
+    assert(l > 0);
+    return _sqr_itch(l);
+}
+
+void u64arr_ll_sqr_scratch(const uint64_t *__restrict__ x, size_t l,
+                           uint64_t *__restrict__ z, uint64_t *__restrict__ t)
+{
+    assert(l > 0);
+    _sqr(x,l,z,t);
+}
+
+void u64arr_ll_sqr(const uint64_t *__restrict__ x, size_t l,
+                   uint64_t *__restrict__ z)
+{
+    uint64_t *t = new uint64_t[u64arr_ll_sqr_itch(l)];
+    u64arr_ll_sqr_scratch(x,l,z,t);
+    delete[] t;
+}
+
+size_t u64arr_ll_mul_itch(size_t lx, size_t ly)
+{
+    assert(lx > 0 and ly > 0);
+    // enough for the squaring case too since x == y is not known here
+    if (lx == ly)
+        return std::max(_mul_itch(lx,ly),_sqr_itch(lx));
+    return _mul_itch(lx,ly);
+}
+
+void u64arr_ll_mul_scratch(const uint64_t *__restrict__ x, size_t lx,
+                           const uint64_t *__restrict__ y, size_t ly,
+                           uint64_t *__restrict__ z, uint64_t *__restrict__ t)
+{
+    assert(lx > 0 and ly > 0);
+    if (x == y and lx == ly)
+        _sqr(x,lx,z,t);
+    else
+        _mul(x,lx,y,ly,z,t);
+}
+
+void u64arr_ll_mul(const uint64_t *__restrict__ x, size_t lx,
+                   const uint64_t *__restrict__ y, size_t ly,
+                   uint64_t *__restrict__ z)
+{
+    uint64_t *t = new uint64_t[u64arr_ll_mul_itch(lx,ly)];
+    u64arr_ll_mul_scratch(x,lx,y,ly,z,t);
+    delete[] t;
+}
+
+// low half {z,n} = {x,n} * {y,n} mod B^n by rows (B = 2^64)
+static void _mullo_basecase(const uint64_t *__restrict__ x,
+                            const uint64_t *__restrict__ y, size_t n,
+                            uint64_t *__restrict__ z)
+{
+    _mul_1(z,y,n,x[0]);
+    for (size_t i = 1; i < n; ++i)
+        _addmul_1(z+i,y,n-i,x[i]);
+}
+
+// high half {z,n} ~= {x,n} * {y,n} / B^n by rows (B = 2^64)
+// only the columns i+j >= n-1 are summed, the rest is less than n*B^n
+// requires n+1 limbs of scratch space at t
+static void _mulhi_basecase(const uint64_t *__restrict__ x,
+                            const uint64_t *__restrict__ y, size_t n,
+                            uint64_t *__restrict__ z, uint64_t *__restrict__ t)
+{
+    // row i adds x[i]*{y+n-1-i,i+1} to column n-1 (limb 0 of t)
+    t[1] = _mul_1(t,y+n-1,1,x[0]);
+    for (size_t i = 1; i < n; ++i)
+        t[i+1] = _addmul_1(t,y+n-1-i,i+1,x[i]);
+    std::copy(t+1,t+n+1,z);
+}
+
+// short products split {x,n} = x1*B^k + x0 with a full product of k limbs
+// and 2 short products of h = n-k limbs for the cross terms
+// (k about 0.7n is best with karatsuba, see Mulders 2000)
+static inline size_t _short_split(size_t n)
+{
+    return std::max((size_t)1,3*n/10);
+}
+
+// short products use the full product when it uses a transform
+static inline bool _short_full(size_t n)
+{
+    _mul_alg_t alg = _mul_alg(n,n);
+    return alg == _MUL_FFT or alg == _MUL_NTT;
+}
+
+// scratch space for _mullo
+static size_t _mullo_itch(size_t n)
+{
+    if (n < U64ARR_LL_MULLO_THRESHOLD)
+        return 0;
+    if (_short_full(n))
+        return 2*n + u64arr_ll_mul_itch(n,n);
+    size_t h = _short_split(n), k = n-h;
+    return 2*k + h + std::max(u64arr_ll_mul_itch(k,k),_mullo_itch(h));
+}
+
+// {z,n} = {x,n} * {y,n} mod B^n
+// requires _mullo_itch(n) limbs of scratch space at t
+static void _mullo(const uint64_t *x, const uint64_t *y, size_t n,
+                   uint64_t *z, uint64_t *t)
+{
+    if (n < U64ARR_LL_MULLO_THRESHOLD)
+    {
+        _mullo_basecase(x,y,n,z);
+        return;
+    }
+    if (_short_full(n))
+    {
+        u64arr_ll_mul_scratch(x,n,y,n,t,t+2*n);
+        std::copy(t,t+n,z);
+        return;
+    }
+    size_t h = _short_split(n), k = n-h;
+    uint64_t *c = t+2*k, *u = c+h;
+    // x0*y0 with all limbs below B^n
+    u64arr_ll_mul_scratch(x,k,y,k,t,u);
+    std::copy(t,t+n,z);
+    // low h limbs of x1*y0 and x0*y1 at limb k
+    _mullo(x+k,y,h,c,u);
+    u64arr_ll_add_to(z+k,h,c,h);
+    if (x != y)
+        _mullo(x,y+k,h,c,u);
+    u64arr_ll_add_to(z+k,h,c,h);
+}
+
+// scratch space for _mulhi
+static size_t _mulhi_itch(size_t n)
+{
+    if (n < U64ARR_LL_MULHI_THRESHOLD)
+        return n+1;
+    if (_short_full(n))
+        return 2*n + u64arr_ll_mul_itch(n,n);
+    size_t h = _short_split(n), k = n-h;
+    return 2*k + h + std::max(u64arr_ll_mul_itch(k,k),_mulhi_itch(h));
+}
+
+// {z,n} ~= {x,n} * {y,n} / B^n, see u64arr_ll_mulhi for the error bound
+// requires _mulhi_itch(n) limbs of scratch space at t
+static void _mulhi(const uint64_t *x, const uint64_t *y, size_t n,
+                   uint64_t *z, uint64_t *t)
+{
+    if (n < U64ARR_LL_MULHI_THRESHOLD)
+    {
+        _mulhi_basecase(x,y,n,z,t);
+        return;
+    }
+    if (_short_full(n))
+    {
+        u64arr_ll_mul_scratch(x,n,y,n,t,t+2*n);
+        std::copy(t+n,t+2*n,z);
+        return;
+    }
+    // x1*B^h*y0 / B^n = x1*y0 / B^k is approximated by the high half of
+    // the top h limbs of x1 times y0, which is off by less than 1 + the
+    // error of the smaller high half
+    size_t h = _short_split(n), k = n-h;
+    uint64_t *c = t+2*k, *u = c+h;
+    // x1*y1*B^(2h) / B^n
+    u64arr_ll_mul_scratch(x+h,k,y+h,k,t,u);
+    std::copy(t+k-h,t+2*k,z);
+    _mulhi(x+n-h,y,h,c,u);
+    bool o = u64arr_ll_add_to(z,n,c,h);
+    assert(!o);
+    if (x != y)
+        _mulhi(x,y+n-h,h,c,u);
+    o = u64arr_ll_add_to(z,n,c,h);
+    assert(!o);
+}
+
+size_t u64arr_ll_mullo_itch(size_t n)
+{
+    assert(n > 0);
+    return _mullo_itch(n);
+}
+
+void u64arr_ll_mullo_scratch(const uint64_t *__restrict__ x,
+                             const uint64_t *__restrict__ y, size_t n,
+                             uint64_t *__restrict__ z, uint64_t *__restrict__ t)
+{
+    assert(n > 0);
+    _mullo(x,y,n,z,t);
+}
+
+void u64arr_ll_mullo(const uint64_t *__restrict__ x,
+                     const uint64_t *__restrict__ y, size_t n,
+                     uint64_t *__restrict__ z)
+{
+    size_t tl = u64arr_ll_mullo_itch(n);
+    uint64_t *t = tl ? new uint64_t[tl] : nullptr;
+    u64arr_ll_mullo_scratch(x,y,n,z,t);
+    delete[] t;
+}
+
+size_t u64arr_ll_mulhi_itch(size_t n)
+{
+    assert(n > 0);
+    return _mulhi_itch(n);
+}
+
+void u64arr_ll_mulhi_scratch(const uint64_t *__restrict__ x,
+                             const uint64_t *__restrict__ y, size_t n,
+                             uint64_t *__restrict__ z, uint64_t *__restrict__ t)
+{
+    assert(n > 0);
+    _mulhi(x,y,n,z,t);
+}
+
+void u64arr_ll_mulhi(const uint64_t *__restrict__ x,
+                     const uint64_t *__restrict__ y, size_t n,
+                     uint64_t *__restrict__ z)
+{
+    uint64_t *t = new uint64_t[u64arr_ll_mulhi_itch(n)];
+    u64arr_ll_mulhi_scratch(x,y,n,z,t);
+    delete[] t;
+}
+
+// a product {z,lx+ly} = {x,lx} * {y,ly} for _mul_tasks_mt
+struct _mul_task
+{
+    const uint64_t *x, *y;
+    size_t lx, ly;
+    uint64_t *z;
+};
+
+static void _mul_mt(const uint64_t *x, size_t lx,
+                    const uint64_t *y, size_t ly,
+                    uint64_t *z, unsigned threads);
+
+// does the k independent products in tasks in parallel, sharing threads
+static void _mul_tasks_mt(const _mul_task *tasks, size_t k, unsigned threads)
+{
+    _run_tasks(k,threads,[&](size_t i)
+    {
+        const _mul_task &p = tasks[i];
+        _mul_mt(p.x,p.lx,p.y,p.ly,p.z,_task_threads(k,threads,i));
+    });
+}
+
+// {z,lx+ly} = {x,lx} * {y,ly} with x split into pieces of at least ly
+// limbs that are multiplied by y in parallel (the grid rows for small ly)
+// products of even pieces go directly in z, odd pieces are added after
+static void _mul_pieces_mt(const uint64_t *x, size_t lx,
+                           const uint64_t *y, size_t ly,
+                           uint64_t *z, unsigned threads)
+{
+    size_t c = std::max((lx+threads-1)/threads,ly); // piece length
+    size_t k = (lx+c-1)/c; // number of pieces
+    uint64_t *p = new uint64_t[(k/2)*(c+ly)];
+    for (size_t i = 0; i < lx+ly; ++i)
+        z[i] = 0;
+    _mul_task *tasks = new _mul_task[k];
+    for (size_t i = 0; i < k; ++i)
+        tasks[i] = {x+i*c,y,std::min(c,lx-i*c),ly,
+                    i%2 ? p+(i/2)*(c+ly) : z+i*c};
+    _mul_tasks_mt(tasks,k,threads);
+    for (size_t i = 1; i < k; i += 2)
+    {
+        bool o = u64arr_ll_add_to(z+i*c,lx+ly-i*c,tasks[i].z,
+                                  tasks[i].lx+ly);
+        assert(!o);
+    }
+    delete[] tasks;
+    delete[] p;
+}
+
+// {z,lx+ly} = {x,lx} * {y,ly} using up to threads threads
+// the products at the top levels of karatsuba and toom-k recursion are done
+// in parallel (each allocating its own scratch space), transforms are split
+// among the threads and long operands are split into pieces
+static void _mul_mt(const uint64_t *x, size_t lx,
+                    const uint64_t *y, size_t ly,
+                    uint64_t *z, unsigned threads)
+{
+    if (lx < ly)
+    {
+        std::swap(x,y);
+        std::swap(lx,ly);
+    }
+    bool sqr = (x == y and lx == ly);
+    _mul_alg_t alg = _mul_alg(lx,ly);
+    // splitting into pieces requires at least 2 pieces of ly limbs
+    if (threads <= 1 or lx+ly < U64ARR_LL_MUL_MT_THRESHOLD
+            or (alg == _MUL_BASECASE and lx < 2*ly))
+    {
+        size_t tl = sqr ? _sqr_itch(lx) : _mul_itch(lx,ly);
+        uint64_t *t = tl ? new uint64_t[tl] : nullptr;
+        if (sqr)
+            _sqr(x,lx,z,t);
+        else
+            _mul(x,lx,y,ly,z,t);
+        delete[] t;
+        return;
+    }
+    size_t h, m, L;
+    uint64_t *t;
+    bool neg, neg1, neg2;
+    switch (alg)
+    {
+    case _MUL_BASECASE:
+    case _MUL_UNBALANCED:
+        _mul_pieces_mt(x,lx,y,ly,z,threads);
+        break;
+    case _MUL_KARATSUBA: // see _mul_karatsuba
+    {
+        h = (lx+1)/2;
+        t = new uint64_t[4*h+1];
+        neg = _sub_abs(x,h,x+h,lx-h,t+2*h) != _sub_abs(y,h,y+h,ly-h,t+3*h);
+        _mul_task tasks[3] = {{t+2*h,t+3*h,h,h,t},
+                              {x,y,h,h,z},
+                              {x+h,y+h,lx-h,ly-h,z+2*h}};
+        _mul_tasks_mt(tasks,3,threads);
+        _karatsuba_finish(z,lx,ly,h,t,neg,t+2*h);
+        delete[] t;
+        break;
+    }
+    case _MUL_TOOM3: // see _mul_toom3
+    {
+        m = (lx+2)/3;
+        L = 2*m+2;
+        t = new uint64_t[6*L];
+        uint64_t *e = t+3*L, *ye = e+3*(m+1);
+        neg = _toom3_eval(x,lx,m,e,e+(m+1),e+2*(m+1))
+           != _toom3_eval(y,ly,m,ye,ye+(m+1),ye+2*(m+1));
+        _mul_task tasks[5] = {{x,y,m,m,z},
+                              {x+2*m,y+2*m,lx-2*m,ly-2*m,z+4*m}};
+        for (size_t i = 0; i < 3; ++i)
+            tasks[2+i] = {e+i*(m+1),ye+i*(m+1),m+1,m+1,t+i*L};
+        _mul_tasks_mt(tasks,5,threads);
+        _toom3_interp(z,lx+ly,m,t,t+L,neg,t+2*L,e);
+        delete[] t;
+        break;
+    }
+    case _MUL_TOOM4: // see _mul_toom4
+    {
+        m = (lx+3)/4;
+        L = 2*m+2;
+        t = new uint64_t[10*L];
+        uint64_t *e = t+5*L, *ye = e+5*(m+1);
+        bool yneg1, yneg2;
+        _toom4_eval(x,lx,m,e,e+(m+1),e+2*(m+1),e+3*(m+1),e+4*(m+1),
+                    &neg1,&neg2);
+        _toom4_eval(y,ly,m,ye,ye+(m+1),ye+2*(m+1),ye+3*(m+1),ye+4*(m+1),
+                    &yneg1,&yneg2);
+        _mul_task tasks[7] = {{x,y,m,m,z},
+                              {x+3*m,y+3*m,lx-3*m,ly-3*m,z+6*m}};
+        for (size_t i = 0; i < 5; ++i)
+            tasks[2+i] = {e+i*(m+1),ye+i*(m+1),m+1,m+1,t+i*L};
+        _mul_tasks_mt(tasks,7,threads);
+        _toom4_interp(z,lx+ly,m,t,t+L,neg1 != yneg1,t+2*L,t+3*L,
+                      neg2 != yneg2,t+4*L,e);
+        delete[] t;
+        break;
+    }
+    case _MUL_FFT:
+        t = new uint64_t[_mul_itch(lx,ly)];
+        _mul_fft(x,lx,y,ly,z,t,threads);
+        delete[] t;
+        break;
+    case _MUL_NTT:
+        t = new uint64_t[12*_ntt_len(lx,ly)];
+        _mul_ntt(x,lx,y,ly,z,t,threads);
+        delete[] t;
+        break;
+    }
+}
+
+void u64arr_ll_mul_mt(const uint64_t *__restrict__ x, size_t lx,
+                      const uint64_t *__restrict__ y, size_t ly,
+                      uint64_t *__restrict__ z, unsigned threads)
+{
+    assert(lx > 0 and ly > 0);
+    _mul_mt(x,lx,y,ly,z,threads);
+}
+
+// schoolbook division (Knuth algorithm D) of normalized numbers
+// {q,lx-ly+1} = {x,lx+1} / {y,ly} and the remainder is left in {x,ly}
+// requires the highest bit of y to be set, ly >= 2, and {x+lx-ly+1,ly}
+// to be less than {y,ly} (true after shifting both left by the same amount
+// into an extra top limb)
+static void _div_schoolbook(uint64_t *__restrict__ x, size_t lx,
+                            const uint64_t *__restrict__ y, size_t ly,
+                            uint64_t *__restrict__ q)
+{
+    assert(ly >= 2 and lx >= ly and (y[ly-1] >> 63));
+    const uint64_t d1 = y[ly-1], d0 = y[ly-2];
+    for (size_t j = lx-ly+1; j--;)
+    {
+        // estimate the quotient limb from the top 3 limbs by 2 limbs
+        // it is then at most 1 too large
+        uint64_t u2 = x[j+ly], u1 = x[j+ly-1], u0 = x[j+ly-2];
+        uint64_t qh, rh;
+        bool rh_big; // remainder of the 2 by 1 estimate is >= 2^64
+        assert(u2 <= d1);
+        if (u2 == d1)
+        {
+            qh = UINT64_MAX;
+            rh = u1 + d1;
+            rh_big = rh < u1;
+        }
+        else
+        {
+            _udiv64_1(u1,u2,d1,&qh,&rh);
+            rh_big = false;
+        }
+        while (!rh_big)
+        {
+            uint64_t p0, p1;
+            _mul64full(qh,d0,&p0,&p1);
+            if (p1 < rh or (p1 == rh and p0 <= u0))
+                break;
+            --qh;
+            rh += d1;
+            rh_big = rh < d1;
+        }
+        // subtract qh*y and add y back if that was 1 too many
+        uint64_t b = _submul_1(x+j,y,ly,qh);
+        bool o = u2 < b;
+        x[j+ly] = u2 - b;
+        if (o)
+        {
+            --qh;
+            x[j+ly] += u64arr_ll_add_to(x+j,ly,y,ly);
+        }
+        assert(x[j+ly] == 0);
+        q[j] = qh;
+    }
+}
+
+// the divisions below are all of normalized numbers (highest bit of y set)
+// {q,k} + qh*B^k = {x,ly+k} / {y,ly} with the remainder left in {x,ly}
+// returning qh, they require k <= ly and the quotient to be < 2*B^k
+// (true if {x+k,ly} <= {y,ly}, so qh is 0 if {x+k,ly} < {y,ly})
+
+// schoolbook division returning the highest quotient limb, requires ly >= 2
+static bool _div_schoolbook_qh(uint64_t *__restrict__ x, size_t k,
+                               const uint64_t *__restrict__ y, size_t ly,
+                               uint64_t *__restrict__ q)
+{
+    bool qh = _cmp(x+k,ly,y,ly) >= 0;
+    if (qh)
+        u64arr_ll_sub_from(x+k,ly,y,ly);
+    _div_schoolbook(x,ly+k-1,y,ly,q);
+    return qh;
+}
+
+// scratch space for _div_dc
+static size_t _div_dc_itch(size_t k, size_t ly)
+{
+    if (k < U64ARR_LL_DIV_DC_THRESHOLD)
+        return 0;
+    if (k == ly)
+        return std::max(_div_dc_itch(k-k/2,ly),_div_dc_itch(k/2,ly));
+    return std::max(_div_dc_itch(k,k),ly + _mul_itch(k,ly-k));
+}
+
+// divide and conquer division (Burnikel and Ziegler 1998)
+// k == ly splits the quotient into halves which are each k < ly divisions
+// and k < ly divides the top 2k limbs of x by the top k limbs of y then
+// subtracts the quotient times the low ly-k limbs of y, the quotient is
+// then at most 2 too large which is corrected by adding back y
+// so the cost is O(M(n) log(n)) for multiplication cost M(n)
+// requires _div_dc_itch(k,ly) limbs of scratch space at t
+static bool _div_dc(uint64_t *__restrict__ x, size_t k,
+                    const uint64_t *__restrict__ y, size_t ly,
+                    uint64_t *__restrict__ q, uint64_t *__restrict__ t)
+{
+    assert(k <= ly);
+    if (k < U64ARR_LL_DIV_DC_THRESHOLD)
+        return _div_schoolbook_qh(x,k,y,ly,q);
+    uint64_t qh;
+    if (k == ly)
+    {
+        size_t lo = k/2, hi = k-lo;
+        qh = _div_dc(x+lo,hi,y,ly,q+lo,t);
+        if (_div_dc(x,lo,y,ly,q,t))
+            qh += u64arr_ll_inc(q+lo,hi);
+        assert(qh <= 1);
+        return qh;
+    }
+    size_t m = ly-k;
+    qh = _div_dc(x+m,k,y+m,k,q,t);
+    _mul(q,k,y,m,t,t+ly);
+    uint64_t c = u64arr_ll_sub_from(x,ly,t,ly);
+    if (qh)
+        c += u64arr_ll_sub_from(x+k,m,y,m);
+    while (c)
+    {
+        qh -= u64arr_ll_dec(q,k);
+        c -= u64arr_ll_add_to(x,ly,y,ly);
+    }
+    assert(qh <= 1);
+    return qh;
+}
+
+// scratch space for _inv
+static size_t _inv_itch(size_t n)
+{
+    if (n < U64ARR_LL_INV_NEWTON_THRESHOLD)
+        return 2*n + _div_dc_itch(n,n);
+    size_t h = n/2+1;
+    return std::max(_inv_itch(h),3*n+2*h+4 + std::max(_mul_itch(n,h+1),
+                                                      _mul_itch(h+1,n+1)));
+}
+
+// {v,n+1} ~= (B^(2n)-1) / {y,n} for normalized {y,n}
+// the result is at most a few units too small (never too large)
+// newton iteration on the top h = n/2+1 limbs of y computes a reciprocal
+// a ~= B^(n+h)/y then e = B^(n+h) - y*a and v = a*B^(n-h) + a*e/B^(2h)
+// (the extra limb in h keeps the error from growing with each step)
+// requires _inv_itch(n) limbs of scratch space at t
+static void _inv(const uint64_t *__restrict__ y, size_t n,
+                 uint64_t *__restrict__ v, uint64_t *__restrict__ t)
+{
+    if (n < U64ARR_LL_INV_NEWTON_THRESHOLD)
+    {
+        std::fill(t,t+2*n,UINT64_MAX);
+        v[n] = _div_dc(t,n,y,n,v,t+2*n);
+        assert(v[n] == 1);
+        return;
+    }
+    size_t h = n/2+1;
+    uint64_t *a = v+n-h, *p = t, *e = p+n+h+1, *m = e+n+1, *u = m+n+h+2;
+    _inv(y+n-h,h,a,t);
+    std::fill(v,a,0);
+    // |e| < B^(n+1) so p is B^(n+h) - e with limbs above n being 0 or 1
+    _mul(y,n,a,h+1,p,u);
+    bool neg = p[n+h];
+    assert(p[n+h] <= 1);
+    assert(std::all_of(p+n+1,p+n+h,
+                       [neg](uint64_t w){ return w == (neg ? 0 : UINT64_MAX); }));
+    if (neg)
+        std::copy(p,p+n+1,e);
+    else
+    {
+        for (size_t i = 0; i <= n; ++i)
+            e[i] = ~p[i];
+        u64arr_ll_inc(e,n+1);
+    }
+    _mul(a,h+1,e,n+1,m,u);
+    assert(m[n+h+1] == 0);
+    // round the correction down so v stays below the true reciprocal
+    if (neg)
+    {
+        bool o = u64arr_ll_sub_from(v,n+1,m+2*h,n-h+1);
+        o |= u64arr_ll_dec(v,n+1);
+        assert(!o);
+    }
+    else
+    {
+        bool o = u64arr_ll_add_to(v,n+1,m+2*h,n-h+1);
+        assert(!o);
+    }
+}
+
+// scratch space for _div_newton
+static size_t _div_newton_itch(size_t k, size_t ly)
+{
+    return 2*(k+ly) + 1 + std::max(_mul_itch(k,ly+1),_mul_itch(k,ly));
+}
+
+// division using {v,ly+1} from _inv, requires {x+k,ly} < {y,ly}
+// the quotient is estimated by the top k limbs of x times v which is at
+// most a few units too small, then corrected by subtracting y
+// requires _div_newton_itch(k,ly) limbs of scratch space at t
+static void _div_newton(uint64_t *__restrict__ x, size_t k,
+                        const uint64_t *__restrict__ y, size_t ly,
+                        const uint64_t *__restrict__ v,
+                        uint64_t *__restrict__ q, uint64_t *__restrict__ t)
+{
+    assert(k <= ly);
+    uint64_t *m = t, *p = m+k+ly+1, *u = p+k+ly;
+    _mul(x+ly,k,v,ly+1,m,u);
+    assert(m[ly+k] == 0);
+    std::copy(m+ly,m+ly+k,q);
+    _mul(q,k,y,ly,p,u);
+    bool o = u64arr_ll_sub_from(x,ly+k,p,ly+k);
+    assert(!o);
+    while (x[ly] or _cmp(x,ly,y,ly) >= 0)
+    {
+        x[ly] -= u64arr_ll_sub_from(x,ly,y,ly);
+        o = u64arr_ll_inc(q,k);
+        assert(!o);
+    }
+}
+
+// computing a newton reciprocal costs more than a divide and conquer block
+// of 2ly by ly limbs, but each block using it is cheaper (2 products)
+static inline bool _div_newton_use(size_t lx, size_t ly)
+{
+    return ly >= U64ARR_LL_DIV_NEWTON_THRESHOLD and lx-ly+1 >= 2*ly;
+}
+
+// scratch space for _div
+static size_t _div_itch(size_t lx, size_t ly)
+{
+    size_t qn = lx-ly+1, k = qn % ly;
+    if (ly < U64ARR_LL_DIV_DC_THRESHOLD)
+        return 0;
+    if (!_div_newton_use(lx,ly))
+        return std::max(k ? _div_dc_itch(k,ly) : 0,
+                        qn >= ly ? _div_dc_itch(ly,ly) : 0);
+    return ly+1 + std::max({_inv_itch(ly),
+                            k ? _div_newton_itch(k,ly) : 0,
+                            qn >= ly ? _div_newton_itch(ly,ly) : 0});
+}
+
+// {q,lx-ly+1} = {x,lx+1} / {y,ly} with the remainder left in {x,ly}
+// with the same requirements as _div_schoolbook, choosing the algorithm by
+// the divisor length, the quotient is done in blocks of ly limbs (starting
+// with a shorter block at the top) so a newton reciprocal is reused
+// requires _div_itch(lx,ly) limbs of scratch space at t
+static void _div(uint64_t *__restrict__ x, size_t lx,
+                 const uint64_t *__restrict__ y, size_t ly,
+                 uint64_t *__restrict__ q, uint64_t *__restrict__ t)
+{
+    if (ly < U64ARR_LL_DIV_DC_THRESHOLD)
+    {
+        _div_schoolbook(x,lx,y,ly,q);
+        return;
+    }
+    size_t j = lx-ly+1, k = j % ly;
+    bool newton = _div_newton_use(lx,ly);
+    uint64_t *v = t;
+    if (newton)
+    {
+        _inv(y,ly,v,t+ly+1);
+        t += ly+1;
+    }
+    if (!k)
+        k = ly;
+    while (j)
+    {
+        j -= k;
+        if (newton)
+            _div_newton(x+j,k,y,ly,v,q+j,t);
+        else
+        {
+            bool o = _div_dc(x+j,k,y,ly,q+j,t);
+            assert(!o);
+        }
+        k = ly;
+    }
+}
+
+size_t u64arr_ll_div_itch(size_t lx, size_t ly)
+{
+    assert(lx >= ly and ly > 0);
+    // normalized copies of x (with an extra limb) and y
+    return lx + 1 + ly + _div_itch(lx,ly);
+}
+
+void u64arr_ll_div_scratch(const uint64_t *__restrict__ x, size_t lx,
+                           const uint64_t *__restrict__ y, size_t ly,
+                           uint64_t *__restrict__ q,
+                           uint64_t *__restrict__ r,
+                           uint64_t *__restrict__ t)
+{
+    assert(lx >= ly and ly > 0);
+    assert(y[ly-1]);
+    if (ly == 1)
+    {
+        uint64_t rr = 0;
+        for (size_t i = lx; i--;)
+            _udiv64_1(x[i],rr,y[0],q+i,&rr);
+        r[0] = rr;
+        return;
+    }
+    // shift so the highest bit of y is set, the quotient does not change
+    unsigned s = __builtin_clzll(y[ly-1]);
+    uint64_t *xn = t, *yn = t+lx+1;
+    std::copy(x,x+lx,xn);
+    std::copy(y,y+ly,yn);
+    xn[lx] = 0;
+    if (s)
+    {
+        xn[lx] = _shl(xn,lx,s);
+        _shl(yn,ly,s);
+    }
+    _div(xn,lx,yn,ly,q,t+lx+1+ly);
+    if (s)
+        _shr(xn,ly,s);
+    std::copy(xn,xn+ly,r);
+}
+
+void u64arr_ll_div(const uint64_t *__restrict__ x, size_t lx,
+                   const uint64_t *__restrict__ y, size_t ly,
+                   uint64_t *__restrict__ q,
+                   uint64_t *__restrict__ r)
+{
+    uint64_t *t = new uint64_t[u64arr_ll_div_itch(lx,ly)];
+    u64arr_ll_div_scratch(x,lx,y,ly,q,r,t);
+    delete[] t;
+}
+
+// exact division is Hensel division (from the least significant limb)
+// the quotient modulo B^n only depends on the low n limbs of x and y
+// divisors must be odd so their lowest limb is invertible modulo B
+
+// {q,n} = {x,n} / {y,ly} mod B^n, requires y odd
+// each quotient limb is chosen to make the lowest limb of x zero
+// only limbs below n of {x,n} are updated (and destroyed)
+static void _divexact_basecase(uint64_t *__restrict__ x, size_t n,
+                               const uint64_t *__restrict__ y, size_t ly,
+                               uint64_t *__restrict__ q)
+{
+    uint64_t inv = _binvert64(y[0]);
+    for (size_t i = 0; i < n; ++i)
+    {
+        q[i] = x[i] * inv;
+        size_t l = std::min(ly,n-i);
+        uint64_t b = _submul_1(x+i,y,l,q[i]);
+        if (i+l < n)
+            u64arr_ll_sub_64(x+i+l,n-i-l,b);
+    }
+}
+
+// {q,n} = {x,2n} / {y,n} mod B^n and {x,2n} -= q*y (so {x,n} becomes 0)
+// returns the borrow out of {x,2n}, requires y odd
+static bool _bdiv_qr_basecase(uint64_t *__restrict__ x,
+                              const uint64_t *__restrict__ y, size_t n,
+                              uint64_t *__restrict__ q)
+{
+    uint64_t inv = _binvert64(y[0]);
+    bool c = false;
+    for (size_t i = 0; i < n; ++i)
+    {
+        q[i] = x[i] * inv;
+        // the borrow limb goes to x[i+n] with the borrow bit from before
+        uint64_t b = _submul_1(x+i,y,n,q[i]) + c;
+        c = b < c;
+        uint64_t u = x[i+n];
+        x[i+n] = u - b;
+        c |= u < b;
+    }
+    return c;
+}
+
+// scratch space for _bdiv_qr
+static size_t _bdiv_qr_itch(size_t n)
+{
+    if (n < U64ARR_LL_DIVEXACT_DC_THRESHOLD)
+        return 0;
+    size_t lo = n/2, hi = n-lo;
+    return std::max({_bdiv_qr_itch(lo),_bdiv_qr_itch(hi),
+                     n + _mul_itch(hi,lo)});
+}
+
+// same as _bdiv_qr_basecase using divide and conquer
+// the low half of the quotient is from the low half of y, then x is updated
+// with its product by the high half of y, and the same for the high half
+// requires _bdiv_qr_itch(n) limbs of scratch space at t
+static bool _bdiv_qr(uint64_t *__restrict__ x,
+                     const uint64_t *__restrict__ y, size_t n,
+                     uint64_t *__restrict__ q, uint64_t *__restrict__ t)
+{
+    if (n < U64ARR_LL_DIVEXACT_DC_THRESHOLD)
+        return _bdiv_qr_basecase(x,y,n,q);
+    size_t lo = n/2, hi = n-lo;
+    bool c = _bdiv_qr(x,y,lo,q,t);
+    // the product is below B^n - B^lo so adding the borrow does not carry
+    _mul(y+lo,hi,q,lo,t,t+n);
+    if (c)
+        u64arr_ll_inc(t+lo,hi);
+    bool b = u64arr_ll_sub_from(x+lo,n+hi,t,n);
+    c = _bdiv_qr(x+lo,y,hi,q+lo,t);
+    _mul(q+lo,hi,y+hi,lo,t,t+n);
+    if (c)
+        u64arr_ll_inc(t+hi,lo);
+    b |= u64arr_ll_sub_from(x+n,n,t,n);
+    return b;
+}
+
+// scratch space for _bdiv_q
+static size_t _bdiv_q_itch(size_t n)
+{
+    if (n < U64ARR_LL_DIVEXACT_Q_DC_THRESHOLD)
+        return 0;
+    size_t lo = (n+1)/2, hi = n-lo;
+    return std::max({_bdiv_qr_itch(lo),_bdiv_q_itch(hi),
+                     hi + _mullo_itch(hi)});
+}
+
+// {q,n} = {x,n} / {y,n} mod B^n using divide and conquer
+// like _divexact_basecase but {x,n+1} is destroyed (1 more limb)
+// requires _bdiv_q_itch(n) limbs of scratch space at t
+static void _bdiv_q(uint64_t *__restrict__ x,
+                    const uint64_t *__restrict__ y, size_t n,
+                    uint64_t *__restrict__ q, uint64_t *__restrict__ t)
+{
+    if (n < U64ARR_LL_DIVEXACT_Q_DC_THRESHOLD)
+    {
+        _divexact_basecase(x,n,y,n,q);
+        return;
+    }
+    // the low half is at least as long so its product with the high half
+    // of y only needs a short product, its borrow is at limb 2*lo >= n
+    size_t lo = (n+1)/2, hi = n-lo;
+    _bdiv_qr(x,y,lo,q,t);
+    _mullo(q,y+lo,hi,t,t+hi);
+    u64arr_ll_sub_from(x+lo,hi,t,hi);
+    _bdiv_q(x+lo,y,hi,q+lo,t);
+}
+
+// scratch space for _binvert
+static size_t _binvert_itch(size_t n)
+{
+    if (n == 1)
+        return 0;
+    size_t h = (n+1)/2;
+    return std::max(_binvert_itch(h),
+                    n + std::max(_mullo_itch(n),_mullo_itch(n-h)));
+}
+
+// {v,n} = {y,n}^-1 mod B^n, requires y odd
+// newton iteration v = v*(2-y*v) from the inverse modulo B^h (h = n/2
+// rounded up) where y*v = 1 + e*B^h so the high limbs are -v*e mod B^(n-h)
+// requires _binvert_itch(n) limbs of scratch space at t
+static void _binvert(const uint64_t *__restrict__ y, size_t n,
+                     uint64_t *__restrict__ v, uint64_t *__restrict__ t)
+{
+    if (n == 1)
+    {
+        v[0] = _binvert64(y[0]);
+        return;
+    }
+    size_t h = (n+1)/2;
+    _binvert(y,h,v,t);
+    std::fill(v+h,v+n,0);
+    _mullo(y,v,n,t,t+n);
+    assert(t[0] == 1);
+    _mullo(v,t+h,n-h,v+h,t+n);
+    for (size_t i = h; i < n; ++i)
+        v[i] = ~v[i];
+    u64arr_ll_inc(v+h,n-h);
+}
+
+// scratch space for _bdiv_newton
+static size_t _bdiv_newton_itch(size_t n, size_t b)
+{
+    return std::max({_mullo_itch(b),n % b ? _mullo_itch(n % b) : 0,
+                     2*b + _mul_itch(b,b)});
+}
+
+// {q,n} = {x,n} / {y,b} mod B^n in blocks of b limbs
+// using {v,b} = {y,b}^-1 mod B^b from _binvert
+// each block of the quotient is a short product of the low limbs of x and v
+// which is then multiplied by y and subtracted
+// requires b == n or b < n with {y,b} being all of y
+// requires _bdiv_newton_itch(n,b) limbs of scratch space at t
+static void _bdiv_newton(uint64_t *__restrict__ x, size_t n,
+                         const uint64_t *__restrict__ y, size_t b,
+                         const uint64_t *__restrict__ v,
+                         uint64_t *__restrict__ q, uint64_t *__restrict__ t)
+{
+    for (size_t j = 0; j < n; j += b)
+    {
+        size_t c = std::min(b,n-j);
+        _mullo(x+j,v,c,q+j,t);
+        if (j+c == n)
+            break;
+        // the product is b+b limbs, only those below n are needed
+        _mul(q+j,b,y,b,t,t+2*b);
+        size_t l = std::min(2*b,n-j);
+        u64arr_ll_sub_from(x+j,n-j,t,l);
+    }
+}
+
+size_t u64arr_ll_divexact_itch(size_t lx, size_t ly)
+{
+    assert(lx >= ly and ly > 0);
+    // blocks of b quotient limbs reuse a divisor of b limbs
+    size_t n = lx-ly+1, b = std::min(ly,n);
+    bool dc = b >= U64ARR_LL_DIVEXACT_DC_THRESHOLD;
+    bool newton = b >= U64ARR_LL_DIVEXACT_NEWTON_THRESHOLD and n >= 2*b;
+    // shifted copies of x and y, then the inverse or block scratch space
+    size_t itch = n+b+1 + b+1;
+    if (newton)
+        itch += b + std::max(_binvert_itch(b),_bdiv_newton_itch(n,b));
+    else if (dc)
+        itch += std::max({_bdiv_qr_itch(b),_bdiv_q_itch(b),
+                          n % b ? std::max(_bdiv_qr_itch(n % b),
+                                           b + _mul_itch(n % b,b - n % b))
+                                : 0});
+    return itch;
+}
+
+void u64arr_ll_divexact_scratch(const uint64_t *__restrict__ x, size_t lx,
+                                const uint64_t *__restrict__ y, size_t ly,
+                                uint64_t *__restrict__ q,
+                                uint64_t *__restrict__ t)
+{
+    assert(lx >= ly and ly > 0);
+    assert(y[ly-1]);
+    // the block size is from the given lengths to match the scratch space,
+    // the copy of y below is padded with zeros up to it
+    size_t n = lx-ly+1, b = std::min(ly,n);
+    bool dc = b >= U64ARR_LL_DIVEXACT_DC_THRESHOLD;
+    bool newton = b >= U64ARR_LL_DIVEXACT_NEWTON_THRESHOLD and n >= 2*b;
+    // low zero limbs of y are also low zero limbs of x
+    while (!y[0])
+    {
+        assert(!x[0]);
+        ++x, ++y;
+        --lx, --ly;
+    }
+    size_t lxs = n+b+1;
+    uint64_t *xs = t, *ys = xs+lxs, *u = ys+b+1;
+    // shift both so y is odd, the limbs above n and b are only for the bits
+    // shifted in and as the extra limbs the blocks below may overwrite
+    unsigned s = __builtin_ctzll(y[0]);
+    _copy_pad(x,std::min(lx,n+1),xs,lxs);
+    _copy_pad(y,std::min(ly,b+1),ys,b+1);
+    if (s)
+    {
+        _shr(xs,n+1,s);
+        _shr(ys,b+1,s);
+    }
+    if (newton)
+    {
+        _binvert(ys,b,u,u+b);
+        _bdiv_newton(xs,n,ys,b,u,q,u+b);
+    }
+    else if (dc)
+    {
+        // blocks update x with the borrow except the last which only needs
+        // q, so the shorter block (if any) is first (like the top block in
+        // _div) and its product with the high limbs of y is done separately
+        size_t j = 0, k = n % b;
+        if (n > b and k)
+        {
+            bool c = _bdiv_qr(xs,ys,k,q,u);
+            _mul(q,k,ys+k,b-k,u,u+b);
+            if (c)
+                u64arr_ll_inc(u+k,b-k);
+            u64arr_ll_sub_from(xs+k,lxs-k,u,b);
+            j = k;
+        }
+        for (; n-j > b; j += b)
+            if (_bdiv_qr(xs+j,ys,b,q+j,u))
+                u64arr_ll_dec(xs+j+2*b,lxs-j-2*b);
+        _bdiv_q(xs+j,ys,n-j,q+j,u);
+    }
+    else
+        _divexact_basecase(xs,n,ys,b,q);
+}
+
+void u64arr_ll_divexact(const uint64_t *__restrict__ x, size_t lx,
+                        const uint64_t *__restrict__ y, size_t ly,
+                        uint64_t *__restrict__ q)
+{
+    uint64_t *t = new uint64_t[u64arr_ll_divexact_itch(lx,ly)];
+    u64arr_ll_divexact_scratch(x,lx,y,ly,q,t);
+    delete[] t;
+}
+
+void u64arr_ll_modulus_init(u64arr_ll_modulus *mod,
+                            const uint64_t *m, size_t l)
+{
+    assert(l > 0 and m[l-1]);
+    mod->n = l;
+    mod->s = __builtin_clzll(m[l-1]);
+    mod->y = new uint64_t[2*l+3];
+    mod->v = mod->y + l+1;
+    _copy_pad(m,l,mod->y,l+1);
+    if (mod->s)
+        _shl(mod->y,l,mod->s);
+    // the reciprocal is shifted up a limb so the short product estimating
+    // the quotient has a limb below it to absorb its error
+    mod->v[0] = 0;
+    if (l == 1)
+    {
+        mod->v[1] = _udiv64_reciprocal(mod->y[0]);
+        mod->v[2] = 1;
+    }
+    else
+    {
+        uint64_t *t = new uint64_t[_inv_itch(l)];
+        _inv(mod->y,l,mod->v+1,t);
+        delete[] t;
+    }
+}
+
+void u64arr_ll_modulus_free(u64arr_ll_modulus *mod)
+{
+    delete[] mod->y;
+    mod->y = mod->v = nullptr;
+}
+
+// reduce {w,n+k} to {w,n} for k <= n, requires {w+k,n} < y (the normalized
+// modulus), the quotient is estimated from the top k limbs times the top k+2
+// limbs of the reciprocal (each truncation makes it at most 1 too small, so
+// only a few corrections are needed)
+// requires a and z with n+2 limbs and max(_mulhi_itch(n+2),_mullo_itch(n+1))
+// limbs of scratch space at u
+static void _mod_pre_block(uint64_t *__restrict__ w, size_t k,
+                           const u64arr_ll_modulus *mod,
+                           uint64_t *__restrict__ a, uint64_t *__restrict__ z,
+                           uint64_t *__restrict__ u)
+{
+    size_t n = mod->n;
+    a[0] = a[1] = 0;
+    std::copy(w+n,w+n+k,a+2);
+    _mulhi(a,mod->v+n-k,k+2,z,u);
+    assert(!z[k+1]);
+    // the remainder is below B^(n+1) so only the low limbs are needed
+    if (k == 1)
+        u64arr_ll_submul_64(w,mod->y,n+1,z[1]);
+    else
+    {
+        _copy_pad(z+1,k,a,n+1);
+        _mullo(a,mod->y,n+1,z,u);
+        u64arr_ll_sub_from(w,n+1,z,n+1);
+    }
+    while (w[n] or _cmp(w,n,mod->y,n) >= 0)
+        w[n] -= u64arr_ll_sub_from(w,n,mod->y,n);
+}
+
+size_t u64arr_ll_mod_pre_itch(size_t lx, const u64arr_ll_modulus *mod)
+{
+    size_t n = mod->n;
+    return std::max(lx,n)+1 + 2*(n+2) + std::max(_mulhi_itch(n+2),
+                                                 _mullo_itch(n+1));
+}
+
+void u64arr_ll_mod_pre_scratch(const uint64_t *__restrict__ x, size_t lx,
+                               const u64arr_ll_modulus *mod,
+                               uint64_t *__restrict__ r,
+                               uint64_t *__restrict__ t)
+{
+    size_t n = mod->n, l = std::max(lx,n);
+    unsigned s = mod->s;
+    if (n == 1)
+    {
+        // 2 by 1 division with the same reciprocal is cheaper
+        u64arr_ll_divisor_64 dv = {mod->y[0],mod->v[1],s};
+        r[0] = u64arr_ll_mod_64_pre(x,lx,&dv);
+        return;
+    }
+    uint64_t *xs = t, *a = xs+l+1, *z = a+n+2, *u = z+n+2;
+    _copy_pad(x,lx,xs,l+1);
+    if (s)
+        xs[l] = _shl(xs,l,s);
+    // blocks of n limbs from the top with a shorter block first (the same
+    // as _div)
+    size_t j = l+1-n, k = j % n;
+    if (!k)
+        k = n;
+    while (j)
+    {
+        j -= k;
+        _mod_pre_block(xs+j,k,mod,a,z,u);
+        k = n;
+    }
+    if (s)
+        _shr(xs,n,s);
+    std::copy(xs,xs+n,r);
+}
+
+void u64arr_ll_mod_pre(const uint64_t *__restrict__ x, size_t lx,
+                       const u64arr_ll_modulus *mod,
+                       uint64_t *__restrict__ r)
+{
+    uint64_t *t = new uint64_t[u64arr_ll_mod_pre_itch(lx,mod)];
+    u64arr_ll_mod_pre_scratch(x,lx,mod,r,t);
+    delete[] t;
+}
+
+/*
+divide and conquer conversion to strings
+*/
+
+// a power of the base, {p,l}, shared between conversions and the cache
+struct _str_power
+{
+    std::shared_ptr<const uint64_t[]> p;
+    size_t l;
+};
+
+// powers base^(e*2^k) by base and level k, each level is computed once
+// (by squaring the previous one) and kept while the total is within the
+// limit, so conversions in the same base reuse them
+static std::mutex _str_cache_mutex;
+static std::vector<_str_power> _str_cache[37];
+static size_t _str_cache_limbs = 0;
+static size_t _str_cache_max = U64ARR_LL_STR_CACHE_LIMBS;
+
+// release the highest cached levels until the total is within the limit
+// (requires _str_cache_mutex)
+static void _str_cache_trim()
+{
+    while (_str_cache_limbs > _str_cache_max)
+    {
+        std::vector<_str_power> *c = nullptr;
+        for (auto &v : _str_cache)
+            if (!v.empty() and (!c or v.back().l > c->back().l))
+                c = &v;
+        _str_cache_limbs -= c->back().l;
+        c->pop_back();
+    }
+}
+
+void u64arr_ll_str_cache_limit(size_t limbs)
+{
+    std::lock_guard<std::mutex> lock(_str_cache_mutex);
+    _str_cache_max = limbs;
+    _str_cache_trim();
+}
+
+void u64arr_ll_str_cache_clear()
+{
+    std::lock_guard<std::mutex> lock(_str_cache_mutex);
+    for (auto &v : _str_cache)
+        v.clear();
+    _str_cache_limbs = 0;
+}
+
+size_t u64arr_ll_str_cache_size()
+{
+    std::lock_guard<std::mutex> lock(_str_cache_mutex);
+    return _str_cache_limbs;
+}
+
+// powers base^(e*2^k) for k < n where e is the number of digits in a limb
+// (the largest power of the base below 2^64)
+// h keeps the powers alive if the cache releases them during a conversion
+struct _str_powers
+{
+    uint8_t base;
+    unsigned e;
+    size_t n;
+    const uint64_t *p[64];
+    size_t l[64];
+    std::shared_ptr<const uint64_t[]> h[64];
+};
+
+// make the powers up to level k available, from the cache if possible
+// missing levels are computed without holding the lock (another thread may
+// compute the same level, then the first one is cached)
+static void _str_powers_grow(_str_powers *pw, size_t k)
+{
+    assert(k < 64);
+    std::vector<_str_power> &c = _str_cache[pw->base];
+    {
+        std::lock_guard<std::mutex> lock(_str_cache_mutex);
+        for (; pw->n <= k and pw->n < c.size(); ++pw->n)
+        {
+            pw->h[pw->n] = c[pw->n].p;
+            pw->l[pw->n] = c[pw->n].l;
+            pw->p[pw->n] = pw->h[pw->n].get();
+        }
+    }
+    for (; pw->n <= k; ++pw->n)
+    {
+        size_t i = pw->n, li;
+        uint64_t *p;
+        if (i == 0)
+        {
+            p = new uint64_t[1];
+            p[0] = _chunk_power(pw->base);
+            li = 1;
+        }
+        else
+        {
+            li = 2*pw->l[i-1];
+            p = new uint64_t[li];
+            u64arr_ll_sqr(pw->p[i-1],pw->l[i-1],p);
+            while (p[li-1] == 0)
+                --li;
+        }
+        pw->h[i] = std::shared_ptr<const uint64_t[]>(p);
+        pw->p[i] = p;
+        pw->l[i] = li;
+        std::lock_guard<std::mutex> lock(_str_cache_mutex);
+        if (c.size() == i and _str_cache_limbs + li <= _str_cache_max)
+        {
+            c.push_back({pw->h[i],li});
+            _str_cache_limbs += li;
+        }
+    }
+}
+
+// start with no powers
+static void _str_powers_init(_str_powers *pw, uint8_t base)
+{
+    pw->base = base;
+    pw->e = _chunk_digits(base);
+    pw->n = 0;
+}
+
+// get the powers needed to split a number of l limbs, the largest one
+// has at most (l+1)/2 limbs
+static void _str_powers_init(_str_powers *pw, uint8_t base, size_t l)
+{
+    _str_powers_init(pw,base);
+    _str_powers_grow(pw,0);
+    while (pw->n < 64 and 4*pw->l[pw->n-1] <= l+1)
+        _str_powers_grow(pw,pw->n);
+}
+
+// release the references to the powers
+static void _str_powers_free(_str_powers *pw)
+{
+    for (size_t k = 0; k < pw->n; ++k)
+        pw->h[k].reset();
+    pw->n = 0;
+}
+
+// level of the power to divide by in a divide and conquer string conversion
+// split at about half of the digits (padded) or limbs (no padding)
+static size_t _write_str_split(const _str_powers *pw, size_t l, size_t w)
+{
+    size_t k = pw->n-1;
+    while (k and (w ? (pw->e << k) > w/2 : 2*pw->l[k] > l+1))
+        --k;
+    return k;
+}
+
+// write {n,l} (modified) to s, most significant digit first
+// if w > 0, exactly w digits are written (with leading zeros) and {n,l}
+// must be below base^w, otherwise there are no leading zeros (so nothing is
+// written for 0), returns the number of digits written
+// above the threshold, n is divided by a power base^(e*2^k) and the quotient
+// and remainder (padded to e*2^k digits) are converted recursively
+static size_t _write_str_dc(const char *_digits, const _str_powers *pw,
+                            uint64_t *n, size_t l, char *s, size_t w,
+                            unsigned threads)
+{
+    while (l and n[l-1] == 0)
+        --l;
+    if (l < U64ARR_LL_WRITE_STR_DC_THRESHOLD)
+        return _write_str_basecase(_digits,pw->base,n,l,s,w);
+    if (l < U64ARR_LL_WRITE_STR_MT_THRESHOLD)
+        threads = 1;
+    size_t k = _write_str_split(pw,l,w);
+    const uint64_t *p = pw->p[k];
+    size_t lp = pw->l[k], wr = pw->e << k;
+    if (l < lp) // only possible with padding, the quotient is 0
+    {
+        assert(w > wr);
+        std::fill(s,s+w-wr,'0');
+        _write_str_dc(_digits,pw,n,l,s+w-wr,wr,threads);
+        return w;
+    }
+    size_t lq = l-lp+1;
+    uint64_t *q = new uint64_t[lq+lp], *r = q+lq;
+    u64arr_ll_div(n,l,p,lp,q,r);
+    // without padding, 2*lp <= l+1 so the quotient is nonzero
+    assert(w or q[lq-1] or q[lq-2]);
+    size_t ret;
+    if (w)
+    {
+        assert(w > wr);
+        _run_tasks(2,threads,[&](size_t i)
+        {
+            if (i == 0)
+                _write_str_dc(_digits,pw,q,lq,s,w-wr,
+                              _task_threads(2,threads,i));
+            else
+                _write_str_dc(_digits,pw,r,lp,s+w-wr,wr,
+                              _task_threads(2,threads,i));
+        });
+        ret = w;
+    }
+    else if (threads > 1)
+    {
+        // the quotient length is not known until it is written, so the
+        // remainder goes to a separate buffer to convert both in parallel
+        char *sr = new char[wr];
+        _run_tasks(2,threads,[&](size_t i)
+        {
+            if (i == 0)
+                ret = _write_str_dc(_digits,pw,q,lq,s,0,
+                                    _task_threads(2,threads,i));
+            else
+                _write_str_dc(_digits,pw,r,lp,sr,wr,
+                              _task_threads(2,threads,i));
+        });
+        std::copy(sr,sr+wr,s+ret);
+        ret += wr;
+        delete[] sr;
+    }
+    else
+    {
+        ret = _write_str_dc(_digits,pw,q,lq,s,0,1);
+        ret += _write_str_dc(_digits,pw,r,lp,s+ret,wr,1);
+    }
+    delete[] q;
+    return ret;
+}
+
+size_t u64arr_ll_write_str_mt(uint8_t base, bool uppercase,
+                              uint64_t *__restrict__ n, size_t l,
+                              char *__restrict__ s, unsigned threads)
+{
+    const char *_digits = _digits1;
+    if (uppercase)
+        _digits = _digits2;
+    while (l and n[l-1] == 0)
+        --l;
+    if (!l) // special case for 0
+    {
+        s[0] = '0';
+        s[1] = '\0';
+        return 1;
+    }
+    size_t ret;
+    switch (base)
+    {
+    case 2:
+        ret = _write_str_pow2<1>(_digits,n,l,s,0);
+        break;
+    case 4:
+        ret = _write_str_pow2<2>(_digits,n,l,s,0);
+        break;
+    case 8:
+        ret = _write_str_pow2<3>(_digits,n,l,s,0);
+        break;
+    case 16:
+        ret = _write_str_pow2<4>(_digits,n,l,s,0);
+        break;
+    case 32:
+        ret = _write_str_pow2<5>(_digits,n,l,s,0);
+        break;
+    default:
+        ret = 0;
+    }
+    if (ret)
+    {
+        s[ret] = '\0';
+        return ret;
+    }
+    _str_powers pw;
+    _str_powers_init(&pw,base,l);
+    ret = _write_str_dc(_digits,&pw,n,l,s,0,threads);
+    _str_powers_free(&pw);
+    s[ret] = '\0';
+    // same as dividing in place to 0 for digits from the least significant
+    std::fill(n,n+l,0);
+    return ret;
+}
+
+size_t u64arr_ll_write_str(uint8_t base, bool uppercase,
+                           uint64_t *__restrict__ n, size_t l,
+                           char *__restrict__ s)
+{
+    return u64arr_ll_write_str_mt(base,uppercase,n,l,s,1);
+}
+
+// {z,} = value of the len digits at s, returns the number of limbs
+// (0 for a character which is not a digit)
+// z must have room for ceil(len/e) limbs (base^e is below 2^64)
+// the last e*2^k digits (about half) are parsed separately and added to the
+// value of the others times base^(e*2^k)
+static size_t _read_str_dc(const _str_powers *pw, const char *s, size_t len,
+                           uint64_t *z)
+{
+    size_t e = pw->e;
+    if (len < e*U64ARR_LL_READ_STR_DC_THRESHOLD)
+        return _read_str_basecase(pw->base,s,len,z);
+    size_t k = pw->n-1;
+    while (k and (e << k) > len/2)
+        --k;
+    size_t wl = e << k, wh = len-wl, lp = pw->l[k];
+    // the low part is below base^wl so it fits in lp limbs
+    uint64_t *lo = new uint64_t[(wl+e-1)/e + (wh+e-1)/e], *hi = lo+(wl+e-1)/e;
+    size_t ll = _read_str_dc(pw,s+wh,wl,lo);
+    size_t lh = ll ? _read_str_dc(pw,s,wh,hi) : 0;
+    if (!lh)
+    {
+        delete[] lo;
+        return 0;
+    }
+    assert(ll <= lp and lh + lp <= (len+e-1)/e);
+    u64arr_ll_mul(hi,lh,pw->p[k],lp,z);
+    bool o = u64arr_ll_add_to(z,lh+lp,lo,ll);
+    assert(!o);
+    delete[] lo;
+    size_t l = lh+lp;
+    while (l > 1 and z[l-1] == 0)
+        --l;
+    return l;
+}
+
+size_t u64arr_ll_read_str(uint8_t base,
+                          const char *__restrict__ s,
+                          uint64_t *__restrict__ n)
+{
+    size_t len = strlen(s), e = _chunk_digits(base);
+    if ((base & (base-1)) == 0 or len < e*U64ARR_LL_READ_STR_DC_THRESHOLD)
+        return _read_str_block(base,s,len,n);
+    // the product at the top may have a zero limb above the result
+    size_t lz = (len+e-1)/e;
+    uint64_t *z = new uint64_t[lz];
+    _str_powers pw;
+    _str_powers_init(&pw,base,lz);
+    size_t l = _read_str_dc(&pw,s,len,z);
+    _str_powers_free(&pw);
+    std::copy(z,z+l,n);
+    delete[] z;
+    return l;
+}
+
+/*
+streaming string conversions
+*/
+
+// destination of the digits of a streaming conversion
+struct _str_sink
+{
+    u64arr_ll_str_out out;
+    void *ctx;
+    char *buf; // digits of a basecase conversion, {buf,cap}
+    size_t cap;
+    char *zeros; // '0' digits for padding, {zeros,cap}
+    size_t len; // number of digits passed to out
+    bool stop; // out returned false
+};
+
+static void _sink_put(_str_sink *k, const char *s, size_t len)
+{
+    if (len and !k->stop)
+    {
+        k->stop = !k->out(k->ctx,s,len);
+        k->len += len;
+    }
+}
+
+static void _sink_zeros(_str_sink *k, size_t w)
+{
+    while (w and !k->stop)
+    {
+        size_t m = std::min(w,k->cap);
+        _sink_put(k,k->zeros,m);
+        w -= m;
+    }
+}
+
+// same as _write_str_dc with one thread, except the digits are passed to
+// the sink as soon as they are final (the quotient is done before the
+// remainder is converted)
+static void _write_str_stream(const char *_digits, const _str_powers *pw,
+                              uint64_t *n, size_t l, size_t w, _str_sink *k)
+{
+    if (k->stop)
+        return;
+    while (l and n[l-1] == 0)
+        --l;
+    if (l < U64ARR_LL_WRITE_STR_DC_THRESHOLD)
+    {
+        size_t len = _write_str_basecase(_digits,pw->base,n,l,k->buf,0);
+        assert(len <= k->cap and (!w or len <= w));
+        if (w)
+            _sink_zeros(k,w-len);
+        _sink_put(k,k->buf,len);
+        return;
+    }
+    size_t i = _write_str_split(pw,l,w);
+    const uint64_t *p = pw->p[i];
+    size_t lp = pw->l[i], wr = pw->e << i;
+    if (l < lp)
+    {
+        assert(w > wr);
+        _sink_zeros(k,w-wr);
+        _write_str_stream(_digits,pw,n,l,wr,k);
+        return;
+    }
+    size_t lq = l-lp+1;
+    uint64_t *q = new uint64_t[lq+lp], *r = q+lq;
+    u64arr_ll_div(n,l,p,lp,q,r);
+    assert(!w or w > wr);
+    _write_str_stream(_digits,pw,q,lq,w ? w-wr : 0,k);
+    _write_str_stream(_digits,pw,r,lp,wr,k);
+    delete[] q;
+}
+
+// power of 2 bases in blocks of 64*b limbs (4096 digits), which do not
+// share digits with each other
+template <unsigned b>
+static void _write_str_pow2_stream(const char *_digits, const uint64_t *n,
+                                   size_t l, _str_sink *k)
+{
+    size_t lb = 64*b, top = (l-1) % lb + 1;
+    assert(k->cap >= 4096);
+    _sink_put(k,k->buf,_write_str_pow2<b>(_digits,n+l-top,top,k->buf,0));
+    for (size_t j = l-top; j and !k->stop; j -= lb)
+    {
+        const uint64_t *m = n+j-lb;
+        size_t lm = lb;
+        while (lm and m[lm-1] == 0)
+            --lm;
+        _sink_put(k,k->buf,_write_str_pow2<b>(_digits,m,lm,k->buf,4096));
+    }
+}
+
+size_t u64arr_ll_write_str_cb(uint8_t base, bool uppercase,
+                              uint64_t *__restrict__ n, size_t l,
+                              u64arr_ll_str_out out, void *ctx)
+{
+    const char *_digits = _digits1;
+    if (uppercase)
+        _digits = _digits2;
+    while (l and n[l-1] == 0)
+        --l;
+    // basecase conversions have fewer than 64 digits per limb
+    size_t cap = std::max((size_t)64*U64ARR_LL_WRITE_STR_DC_THRESHOLD,
+                          (size_t)4096);
+    _str_sink k = {out,ctx,new char[2*cap],cap,nullptr,0,false};
+    k.zeros = k.buf+cap;
+    std::fill(k.zeros,k.zeros+cap,'0');
+    if (!l) // special case for 0
+        _sink_put(&k,"0",1);
+    else if (base == 2)
+        _write_str_pow2_stream<1>(_digits,n,l,&k);
+    else if (base == 4)
+        _write_str_pow2_stream<2>(_digits,n,l,&k);
+    else if (base == 8)
+        _write_str_pow2_stream<3>(_digits,n,l,&k);
+    else if (base == 16)
+        _write_str_pow2_stream<4>(_digits,n,l,&k);
+    else if (base == 32)
+        _write_str_pow2_stream<5>(_digits,n,l,&k);
+    else
+    {
+        _str_powers pw;
+        _str_powers_init(&pw,base,l);
+        _write_str_stream(_digits,&pw,n,l,0,&k);
+        _str_powers_free(&pw);
+        std::fill(n,n+l,0);
+    }
+    delete[] k.buf;
+    return k.stop ? 0 : k.len;
+}
+
+// write all of {s,len} to fd, retrying after partial writes and signals
+static bool _fd_write(int fd, const char *s, size_t len)
+{
+    while (len)
+    {
+        ssize_t r = write(fd,s,len);
+        if (r < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        s += r;
+        len -= r;
+    }
+    return true;
+}
+
+// output buffer for u64arr_ll_write_str_fd
+struct _fd_out
+{
+    int fd;
+    char *buf; // {buf,U64ARR_LL_STR_IO_BLOCK}
+    size_t len;
+};
+
+static bool _fd_out_put(void *ctx, const char *s, size_t len)
+{
+    _fd_out *f = static_cast<_fd_out*>(ctx);
+    if (f->len + len > U64ARR_LL_STR_IO_BLOCK)
+    {
+        if (!_fd_write(f->fd,f->buf,f->len))
+            return false;
+        f->len = 0;
+    }
+    if (len >= U64ARR_LL_STR_IO_BLOCK)
+        return _fd_write(f->fd,s,len);
+    std::copy(s,s+len,f->buf+f->len);
+    f->len += len;
+    return true;
+}
+
+size_t u64arr_ll_write_str_fd(uint8_t base, bool uppercase,
+                              uint64_t *__restrict__ n, size_t l, int fd)
+{
+    _fd_out f = {fd,new char[U64ARR_LL_STR_IO_BLOCK],0};
+    size_t ret = u64arr_ll_write_str_cb(base,uppercase,n,l,_fd_out_put,&f);
+    if (ret and !_fd_write(fd,f.buf,f.len))
+        ret = 0;
+    delete[] f.buf;
+    return ret;
+}
+
+void u64arr_ll_str_reader_init(u64arr_ll_str_reader *rd, uint8_t base)
+{
+    rd->base = base;
+    rd->bad = false;
+    rd->len = 0;
+    // blocks of 2^k chunks of digits, where the basecase is still faster
+    size_t k = 0;
+    while ((1uLL << k) < U64ARR_LL_READ_STR_DC_THRESHOLD)
+        ++k;
+    rd->k = k;
+    rd->lbk = _chunk_digits(base) << k;
+    rd->buf = new char[rd->lbk];
+    rd->lb = 0;
+    rd->nv = 0;
+    rd->pw = new _str_powers;
+    _str_powers_init(rd->pw,base);
+}
+
+// {z,} = {x,lx} * base^(lbk*2^i) + {y,ly} (z allocated), returns its length
+// x and y are released, the power is level k+i of the cached powers
+// for power of 2 bases the multiplication is a shift by the bits of
+// lbk*2^i digits
+static size_t _str_reader_combine(u64arr_ll_str_reader *rd, size_t i,
+                                  uint64_t *x, size_t lx,
+                                  uint64_t *y, size_t ly, uint64_t **z)
+{
+    size_t lz;
+    if ((rd->base & (rd->base-1)) == 0)
+    {
+        size_t bits = (rd->lbk * __builtin_ctz(rd->base)) << i;
+        size_t q = bits/64;
+        unsigned r = bits%64;
+        lz = lx + q + 1;
+        *z = new uint64_t[lz];
+        std::fill(*z,*z+q,0);
+        std::copy(x,x+lx,*z+q);
+        (*z)[lz-1] = r ? _shl(*z+q,lx,r) : 0;
+    }
+    else
+    {
+        _str_powers *pw = rd->pw;
+        size_t k = rd->k + i;
+        _str_powers_grow(pw,k);
+        lz = lx + pw->l[k];
+        *z = new uint64_t[lz];
+        u64arr_ll_mul(x,lx,pw->p[k],pw->l[k],*z);
+    }
+    assert(ly <= lz);
+    bool o = u64arr_ll_add_to(*z,lz,y,ly);
+    assert(!o);
+    delete[] x;
+    delete[] y;
+    while (lz > 1 and (*z)[lz-1] == 0)
+        --lz;
+    return lz;
+}
+
+// parse a complete block and carry it up through the levels
+static void _str_reader_block(u64arr_ll_str_reader *rd, const char *s)
+{
+    size_t lv = rd->lbk / _chunk_digits(rd->base);
+    uint64_t *v = new uint64_t[lv];
+    lv = _read_str_block(rd->base,s,rd->lbk,v);
+    if (!lv)
+    {
+        delete[] v;
+        rd->bad = true;
+        return;
+    }
+    for (size_t i = 0;; ++i)
+    {
+        if (i == rd->nv)
+        {
+            assert(i < 64);
+            rd->v[rd->nv++] = nullptr;
+        }
+        if (!rd->v[i])
+        {
+            rd->v[i] = v;
+            rd->lv[i] = lv;
+            return;
+        }
+        // the pending value has the digits before the new one
+        lv = _str_reader_combine(rd,i,rd->v[i],rd->lv[i],v,lv,&v);
+        rd->v[i] = nullptr;
+    }
+}
+
+bool u64arr_ll_str_reader_feed(u64arr_ll_str_reader *rd,
+                               const char *s, size_t len)
+{
+    rd->len += len;
+    while (len and !rd->bad)
+    {
+        if (rd->lb == 0 and len >= rd->lbk) // parse in place
+        {
+            _str_reader_block(rd,s);
+            s += rd->lbk;
+            len -= rd->lbk;
+            continue;
+        }
+        size_t m = std::min(rd->lbk - rd->lb,len);
+        std::copy(s,s+m,rd->buf+rd->lb);
+        rd->lb += m;
+        s += m;
+        len -= m;
+        if (rd->lb == rd->lbk)
+        {
+            _str_reader_block(rd,rd->buf);
+            rd->lb = 0;
+        }
+    }
+    return !rd->bad;
+}
+
+bool u64arr_ll_str_reader_feed_fd(u64arr_ll_str_reader *rd, int fd)
+{
+    struct stat st;
+    if (fstat(fd,&st) == 0 and S_ISREG(st.st_mode))
+    {
+        off_t pos = lseek(fd,0,SEEK_CUR);
+        if (pos >= 0 and pos < st.st_size)
+        {
+            void *m = mmap(nullptr,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+            if (m != MAP_FAILED)
+            {
+                madvise(m,st.st_size,MADV_SEQUENTIAL);
+                const char *s = static_cast<const char*>(m);
+                bool ok = u64arr_ll_str_reader_feed(rd,s+pos,st.st_size-pos);
+                munmap(m,st.st_size);
+                lseek(fd,0,SEEK_END);
+                return ok;
+            }
+        }
+    }
+    // not mappable (pipes, sockets, terminals), read in blocks
+    char *blk = new char[U64ARR_LL_STR_IO_BLOCK];
+    for (;;)
+    {
+        ssize_t r = read(fd,blk,U64ARR_LL_STR_IO_BLOCK);
+        if (r < 0 and errno == EINTR)
+            continue;
+        if (r < 0)
+            rd->bad = true;
+        if (r <= 0 or !u64arr_ll_str_reader_feed(rd,blk,r))
+            break;
+    }
+    delete[] blk;
+    return !rd->bad;
+}
+
+size_t u64arr_ll_str_reader_limbs(const u64arr_ll_str_reader *rd)
+{
+    size_t e = _chunk_digits(rd->base);
+    return std::max((rd->len+e-1)/e,(size_t)1);
+}
+
+size_t u64arr_ll_str_reader_finish(u64arr_ll_str_reader *rd,
+                                   uint64_t *__restrict__ n)
+{
+    uint64_t *v = nullptr;
+    size_t lv = 0;
+    // pending blocks from the highest level have the earliest digits
+    for (size_t i = rd->nv; i-- > 0 and !rd->bad;)
+    {
+        if (!rd->v[i])
+            continue;
+        if (v)
+            lv = _str_reader_combine(rd,i,v,lv,rd->v[i],rd->lv[i],&v);
+        else
+        {
+            v = rd->v[i];
+            lv = rd->lv[i];
+        }
+        rd->v[i] = nullptr;
+    }
+    if (rd->lb and !rd->bad)
+    {
+        // the digits of the incomplete block and base^lb
+        size_t e = _chunk_digits(rd->base), lt = (rd->lb+e-1)/e;
+        uint64_t *t = new uint64_t[lt], *p = new uint64_t[lt+1];
+        lt = _read_str_block(rd->base,rd->buf,rd->lb,t);
+        size_t lp = 1;
+        p[0] = 1;
+        for (size_t j = 0; j < rd->lb; j += e)
+        {
+            uint64_t m = 1;
+            for (size_t i = j; i < std::min(j+e,rd->lb); ++i)
+                m *= rd->base;
+            uint64_t c = u64arr_ll_mul_64(p,lp,m);
+            if (c)
+                p[lp++] = c;
+        }
+        if (!lt)
+        {
+            rd->bad = true;
+            delete[] t;
+        }
+        else if (v)
+        {
+            size_t lz = lv + lp;
+            uint64_t *z = new uint64_t[lz];
+            u64arr_ll_mul(v,lv,p,lp,z);
+            bool o = u64arr_ll_add_to(z,lz,t,lt);
+            assert(!o);
+            delete[] v;
+            delete[] t;
+            v = z;
+            lv = lz;
+            while (lv > 1 and v[lv-1] == 0)
+                --lv;
+        }
+        else
+        {
+            v = t;
+            lv = lt;
+        }
+        delete[] p;
+    }
+    size_t ret = 0;
+    if (!rd->bad)
+    {
+        if (v)
+            std::copy(v,v+lv,n);
+        else // no digits
+            n[lv++] = 0;
+        assert(lv <= u64arr_ll_str_reader_limbs(rd));
+        ret = lv;
+    }
+    delete[] v;
+    for (size_t i = 0; i < rd->nv; ++i)
+        delete[] rd->v[i];
+    _str_powers_free(rd->pw);
+    delete rd->pw;
+    delete[] rd->buf;
+    return ret;
 }
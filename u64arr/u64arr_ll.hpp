@@ -16,6 +16,8 @@ without needing slower base conversion
 #include <cstdint>
 #include <cstdlib>
 
+#include "../utils/u64ops.h"
+
 /*
 low level in-place operations with small numbers (modify inputs)
 */
@@ -52,8 +54,95 @@ uint32_t u64arr_ll_div_32(uint64_t *n, size_t l, uint32_t a);
 
 // divide {n,l} by a 64 bit integer
 // returns remainder (modulus)
+// longer inputs use a precomputed reciprocal (see u64arr_ll_divisor_64)
 uint64_t u64arr_ll_div_64(uint64_t *n, size_t l, uint64_t a);
 
+// compute {n,l} mod a 64 bit integer (nonzero), input not modified
+// longer inputs are folded 4 limbs at a time with precomputed 2^(64*k) mod a
+// so the multiplications are independent instead of one division per limb
+uint64_t u64arr_ll_mod_64(const uint64_t *n, size_t l, uint64_t a);
+
+// divide {n,l} by a 64 bit integer (nonzero) which is known to divide it
+// works from the least significant limb using an inverse modulo 2^64
+// (no division instructions), the result is undefined if a does not divide n
+void u64arr_ll_divexact_64(uint64_t *n, size_t l, uint64_t a);
+
+// precomputed data for repeated division by the same 64 bit integer
+// division loops using it need only multiplications (no divq per limb)
+struct u64arr_ll_divisor_64
+{
+    uint64_t d; // divisor shifted left so its highest bit is set
+    uint64_t v; // reciprocal floor((2^128-1)/d) - 2^64
+    unsigned s; // left shift amount used to normalize the divisor
+};
+
+// initialize the divisor object for dividing by a (nonzero)
+void u64arr_ll_divisor_64_init(u64arr_ll_divisor_64 *dv, uint64_t a);
+
+// divide {n,l} by a precomputed divisor
+// returns remainder (modulus)
+uint64_t u64arr_ll_div_64_pre(uint64_t *n, size_t l,
+                              const u64arr_ll_divisor_64 *dv);
+
+// compute {n,l} mod a precomputed divisor (input not modified)
+uint64_t u64arr_ll_mod_64_pre(const uint64_t *n, size_t l,
+                              const u64arr_ll_divisor_64 *dv);
+
+// normalized divisor and reciprocal (as in u64arr_ll_divisor_64) for a
+// constant divisor, computed at compile time
+template <uint64_t D>
+struct u64arr_ll_divisor_const
+{
+    static_assert(D > 0, "division by zero");
+    static constexpr unsigned s = __builtin_clzll(D);
+    static constexpr uint64_t d = D << s;
+    // floor((2^128-1)/d) - 2^64 = floor((2^128-1 - d*2^64)/d)
+    static constexpr uint64_t v =
+        ((((__uint128_t)~d) << 64) | ~(uint64_t)0) / d;
+};
+
+// divide {n,l} by a constant 64 bit integer D (nonzero)
+// returns remainder (modulus)
+// each limb needs 2 multiplications with constants (no divq instruction),
+// and powers of 2 are only shifts
+template <uint64_t D>
+uint64_t u64arr_ll_div_const(uint64_t *n, size_t l)
+{
+    typedef u64arr_ll_divisor_const<D> dc;
+    uint64_t r = 0;
+    if constexpr (D == 1)
+        return 0;
+    else if constexpr ((D & (D-1)) == 0)
+    {
+        constexpr unsigned k = 63 - dc::s; // D = 2^k
+        for (size_t i = l; i--;)
+        {
+            uint64_t t = n[i];
+            n[i] = (t >> k) | (r << (64-k));
+            r = t & (D-1);
+        }
+        return r;
+    }
+    else if constexpr (dc::s == 0)
+    {
+        for (size_t i = l; i--;)
+            _udiv64_pre(n[i],r,dc::d,dc::v,n+i,&r);
+        return r;
+    }
+    else
+    {
+        // same as u64arr_ll_div_64_pre with the shift known
+        constexpr unsigned s = dc::s;
+        if (!l)
+            return 0;
+        r = n[l-1] >> (64-s);
+        for (size_t i = l-1; i; --i)
+            _udiv64_pre((n[i] << s) | (n[i-1] >> (64-s)),r,dc::d,dc::v,n+i,&r);
+        _udiv64_pre(n[0] << s,r,dc::d,dc::v,n,&r);
+        return r >> s;
+    }
+}
+
 /*
 low level conversion to/from strings
 */
@@ -61,23 +150,113 @@ low level conversion to/from strings
 // convert number {n,l} to string (s)
 // bases 2-36 supported using specified case
 // s must be long enough to fit result and null
-// input is modified for division in place
+// input is modified for division in place (except for power of 2 bases)
 // returns length of result (not including null)
+// power of 2 bases take linear time (digits are bit fields of the limbs),
+// long numbers in other bases are split by divide and conquer with powers
+// of the base
 size_t u64arr_ll_write_str(uint8_t base, bool uppercase,
                            uint64_t *__restrict__ n, size_t l,
                            char *__restrict__ s);
 
+// same as u64arr_ll_write_str using up to threads threads
+// the quotient and remainder of long divide and conquer steps are converted
+// in parallel (threads <= 1 uses only the calling thread)
+size_t u64arr_ll_write_str_mt(uint8_t base, bool uppercase,
+                              uint64_t *__restrict__ n, size_t l,
+                              char *__restrict__ s, unsigned threads);
+
 // convert string (s) to number (n)
 // only bases 2-36 are supported with lowercase/uppercase letters
 // s must end with null and consist only of 0-9 and a-z and A-Z
 // (limited by thet base chosen, use a-z and A-Z for digit values 10-35)
-// if input contains other characters, result is undefined
 // n must be long enough to fit result
-// returns number of limbs in result
+// returns number of limbs in result, or 0 if the input contains a character
+// which is not a digit in the base (then n is unspecified)
+// power of 2 bases take linear time, long strings in other bases are parsed
+// by divide and conquer with powers of the base
 size_t u64arr_ll_read_str(uint8_t base,
                           const char *__restrict__ s,
                           uint64_t *__restrict__ n);
 
+// receives the next len digits of a streaming conversion
+// returns false to stop the conversion
+typedef bool (*u64arr_ll_str_out)(void *ctx, const char *s, size_t len);
+
+// same as u64arr_ll_write_str except the digits are passed to out (with ctx)
+// in blocks as soon as they are final, most significant first, instead of
+// being written to a buffer (no null is passed)
+// besides {n,l}, memory used is about the size of {n,l} (for quotients and
+// powers of the base) and does not depend on the length of the string
+// returns the number of digits, or 0 if out returned false
+size_t u64arr_ll_write_str_cb(uint8_t base, bool uppercase,
+                              uint64_t *__restrict__ n, size_t l,
+                              u64arr_ll_str_out out, void *ctx);
+
+// same as u64arr_ll_write_str_cb writing the digits to file descriptor fd
+// returns the number of digits, or 0 if a write failed (errno is set)
+size_t u64arr_ll_write_str_fd(uint8_t base, bool uppercase,
+                              uint64_t *__restrict__ n, size_t l, int fd);
+
+// divide and conquer conversions in the same base use the same powers of
+// the base, which are cached (for all threads) until their total size
+// reaches a limit, U64ARR_LL_STR_CACHE_LIMBS limbs by default
+// set the limit (0 disables the cache), the largest cached powers are
+// released until the cache fits
+void u64arr_ll_str_cache_limit(size_t limbs);
+
+// release all cached powers (conversions in progress keep the ones they use)
+void u64arr_ll_str_cache_clear();
+
+// total number of limbs of the cached powers
+size_t u64arr_ll_str_cache_size();
+
+// incremental parsing of a string which arrives in pieces
+// digits are parsed in blocks as soon as a block is complete, equal size
+// blocks are combined in pairs with a power of the base (like carries in a
+// binary counter) so the work is the same as divide and conquer, and only
+// the digits of the last incomplete block are copied
+struct _str_powers; // powers of the base (shared with the cache)
+
+struct u64arr_ll_str_reader
+{
+    uint8_t base;
+    bool bad; // a character which is not a digit (or read error) was seen
+    size_t len; // number of digits fed
+    unsigned k; // a block has 2^k chunks of digits (largest power in a limb)
+    size_t lbk; // number of digits in a block
+    char *buf; // incomplete block, {buf,lbk}
+    size_t lb; // number of digits in buf
+    size_t nv; // number of levels used in v
+    uint64_t *v[64]; // value of the pending 2^i blocks at level i, or null
+    size_t lv[64];
+    _str_powers *pw; // base^(lbk*2^i) is level k+i
+};
+
+// initialize the reader for digits in base (2-36)
+// allocates memory which is released by u64arr_ll_str_reader_finish
+void u64arr_ll_str_reader_init(u64arr_ll_str_reader *rd, uint8_t base);
+
+// parse the next len digits at s (no null needed)
+// returns false if the reader has seen a character which is not a digit
+bool u64arr_ll_str_reader_feed(u64arr_ll_str_reader *rd,
+                               const char *s, size_t len);
+
+// feed all digits from file descriptor fd until end of file
+// regular files are mapped with mmap and parsed in place, others are read in
+// blocks of U64ARR_LL_STR_IO_BLOCK characters
+// returns false on read error or a character which is not a digit
+bool u64arr_ll_str_reader_feed_fd(u64arr_ll_str_reader *rd, int fd);
+
+// number of limbs n must have for u64arr_ll_str_reader_finish
+size_t u64arr_ll_str_reader_limbs(const u64arr_ll_str_reader *rd);
+
+// write the value of the digits fed to n and release the reader memory
+// (must be called even after an error), returns the number of limbs in the
+// result, or 0 if there was an error (then n is not used)
+size_t u64arr_ll_str_reader_finish(u64arr_ll_str_reader *rd,
+                                   uint64_t *__restrict__ n);
+
 /*
 larger in-place operations
 */
@@ -94,6 +273,25 @@ bool u64arr_ll_add_to(uint64_t *__restrict__ n1, size_t l1,
 bool u64arr_ll_sub_from(uint64_t *__restrict__ n1, size_t l1,
                         const uint64_t *__restrict__ n2, size_t l2);
 
+// sets {n1,l} to {n1,l}+{n2,l}*a
+// returns carry limb for going past length l
+uint64_t u64arr_ll_addmul_64(uint64_t *__restrict__ n1,
+                             const uint64_t *__restrict__ n2, size_t l,
+                             uint64_t a);
+
+// sets {n1,l} to {n1,l}-{n2,l}*a
+// returns borrow limb (amount to subtract past length l)
+uint64_t u64arr_ll_submul_64(uint64_t *__restrict__ n1,
+                             const uint64_t *__restrict__ n2, size_t l,
+                             uint64_t a);
+
+// sets {n1,l+1} to {n1,l}+{n2,l}*{a,2}
+// n1 must have length >= l+1 (limb l is overwritten)
+// returns the highest limb (result has length l+2)
+uint64_t u64arr_ll_addmul_2(uint64_t *__restrict__ n1,
+                            const uint64_t *__restrict__ n2, size_t l,
+                            const uint64_t *__restrict__ a);
+
 /*
 operations on same length inputs
 */
@@ -118,17 +316,161 @@ bool u64arr_ll_sub(const uint64_t *__restrict__ x, size_t lx,
 
 // {z,} = {x,lx} * {y,ly}
 // output must have length >= lx+ly
+// uses grid multiplication for small inputs, karatsuba, toom-3, toom-4,
+// a floating point FFT and a number theoretic transform for increasingly
+// larger inputs, if lx and ly are very different then the longer input is
+// split into pieces the length of the shorter one (except with transforms)
 void u64arr_ll_mul(const uint64_t *__restrict__ x, size_t lx,
                    const uint64_t *__restrict__ y, size_t ly,
                    uint64_t *__restrict__ z);
 
+// number of limbs of scratch space needed by u64arr_ll_mul_scratch
+// exact for the algorithms chosen for lx and ly (including squaring)
+size_t u64arr_ll_mul_itch(size_t lx, size_t ly);
+
+// same as u64arr_ll_mul but does not allocate memory
+// t must have length >= u64arr_ll_mul_itch(lx,ly) and not overlap the others
+void u64arr_ll_mul_scratch(const uint64_t *__restrict__ x, size_t lx,
+                           const uint64_t *__restrict__ y, size_t ly,
+                           uint64_t *__restrict__ z, uint64_t *__restrict__ t);
+
+// {z,} = {x,lx} * {y,ly} using up to threads threads
+// same as u64arr_ll_mul except that large products are split into parts
+// which are computed in parallel (threads <= 1 uses only the calling thread)
+// scratch space is allocated for each part
+// output must have length >= lx+ly
+void u64arr_ll_mul_mt(const uint64_t *__restrict__ x, size_t lx,
+                      const uint64_t *__restrict__ y, size_t ly,
+                      uint64_t *__restrict__ z, unsigned threads);
+
+// {z,} = {x,l} * {x,l}
+// output must have length >= 2*l
+// faster than u64arr_ll_mul(x,l,x,l,z) since the symmetry of the product
+// is used by each algorithm (u64arr_ll_mul also detects this case)
+void u64arr_ll_sqr(const uint64_t *__restrict__ x, size_t l,
+                   uint64_t *__restrict__ z);
+
+// number of limbs of scratch space needed by u64arr_ll_sqr_scratch
+size_t u64arr_ll_sqr_itch(size_t l);
+
+// same as u64arr_ll_sqr but does not allocate memory
+// t must have length >= u64arr_ll_sqr_itch(l) and not overlap the others
+void u64arr_ll_sqr_scratch(const uint64_t *__restrict__ x, size_t l,
+                           uint64_t *__restrict__ z, uint64_t *__restrict__ t);
+
+// {z,n} = {x,n} * {y,n} mod 2^(64*n) (low half of the product)
+// x and y may be the same
+// cheaper than u64arr_ll_mul for lengths using karatsuba or toom
+void u64arr_ll_mullo(const uint64_t *__restrict__ x,
+                     const uint64_t *__restrict__ y, size_t n,
+                     uint64_t *__restrict__ z);
+
+// number of limbs of scratch space needed by u64arr_ll_mullo_scratch
+size_t u64arr_ll_mullo_itch(size_t n);
+
+// same as u64arr_ll_mullo but does not allocate memory
+// t must have length >= u64arr_ll_mullo_itch(n) and not overlap the others
+void u64arr_ll_mullo_scratch(const uint64_t *__restrict__ x,
+                             const uint64_t *__restrict__ y, size_t n,
+                             uint64_t *__restrict__ z, uint64_t *__restrict__ t);
+
+// {z,n} ~= {x,n} * {y,n} / 2^(64*n) (high half of the product)
+// x and y may be the same
+// the result is an approximation from below, if h is the exact high half
+// (floor of the quotient) then h-2*n < {z,n} <= h
+// cheaper than u64arr_ll_mul since most of the low half is skipped
+void u64arr_ll_mulhi(const uint64_t *__restrict__ x,
+                     const uint64_t *__restrict__ y, size_t n,
+                     uint64_t *__restrict__ z);
+
+// number of limbs of scratch space needed by u64arr_ll_mulhi_scratch
+size_t u64arr_ll_mulhi_itch(size_t n);
+
+// same as u64arr_ll_mulhi but does not allocate memory
+// t must have length >= u64arr_ll_mulhi_itch(n) and not overlap the others
+void u64arr_ll_mulhi_scratch(const uint64_t *__restrict__ x,
+                             const uint64_t *__restrict__ y, size_t n,
+                             uint64_t *__restrict__ z, uint64_t *__restrict__ t);
+
 // {q,} = {x,lx} / {y,ly}
 // {r,} = {x,lx} % {y,ly}
 // the highest limb in {y,ly} must be nonzero
 // q must have length >= lx-ly+1
 // r must have length >= ly
 // must have lx >= ly
+// uses schoolbook division (Knuth algorithm D) for short divisors,
+// divide and conquer (Burnikel-Ziegler) for longer ones, and a newton
+// reciprocal for long divisors when the quotient is at least twice as long
 void u64arr_ll_div(const uint64_t *__restrict__ x, size_t lx,
                    const uint64_t *__restrict__ y, size_t ly,
                    uint64_t *__restrict__ q,
                    uint64_t *__restrict__ r);
+
+// {q,lx-ly+1} = {x,lx} / {y,ly} when {y,ly} is known to divide {x,lx}
+// the highest limb in {y,ly} must be nonzero
+// must have lx >= ly
+// works from the least significant limb (Hensel division) so no remainder
+// is computed, the result is undefined if y does not divide x
+// uses schoolbook or divide and conquer division, or for long quotients
+// an inverse of y modulo B^ly (newton iteration) reused for each block
+void u64arr_ll_divexact(const uint64_t *__restrict__ x, size_t lx,
+                        const uint64_t *__restrict__ y, size_t ly,
+                        uint64_t *__restrict__ q);
+
+// number of limbs of scratch space needed by u64arr_ll_divexact_scratch
+size_t u64arr_ll_divexact_itch(size_t lx, size_t ly);
+
+// same as u64arr_ll_divexact but does not allocate memory
+// t must have length >= u64arr_ll_divexact_itch(lx,ly) and not overlap
+// the others
+void u64arr_ll_divexact_scratch(const uint64_t *__restrict__ x, size_t lx,
+                                const uint64_t *__restrict__ y, size_t ly,
+                                uint64_t *__restrict__ q,
+                                uint64_t *__restrict__ t);
+
+// number of limbs of scratch space needed by u64arr_ll_div_scratch
+size_t u64arr_ll_div_itch(size_t lx, size_t ly);
+
+// same as u64arr_ll_div but does not allocate memory
+// t must have length >= u64arr_ll_div_itch(lx,ly) and not overlap the others
+void u64arr_ll_div_scratch(const uint64_t *__restrict__ x, size_t lx,
+                           const uint64_t *__restrict__ y, size_t ly,
+                           uint64_t *__restrict__ q,
+                           uint64_t *__restrict__ r,
+                           uint64_t *__restrict__ t);
+
+// precomputed modulus for repeated reduction by the same number
+// (Barrett reduction, using a reciprocal instead of division)
+struct u64arr_ll_modulus
+{
+    size_t n; // length of the modulus (highest limb nonzero)
+    unsigned s; // left shift amount used to normalize the modulus
+    uint64_t *y; // normalized modulus and a zero limb, {y,n+1}
+    uint64_t *v; // reciprocal ~= (2^(128*n)-1)/y shifted up 1 limb, {v,n+2}
+};
+
+// initialize the modulus object for {m,l} (highest limb must be nonzero)
+// allocates memory which is released by u64arr_ll_modulus_free
+void u64arr_ll_modulus_init(u64arr_ll_modulus *mod,
+                            const uint64_t *m, size_t l);
+
+// release memory used by the modulus object
+void u64arr_ll_modulus_free(u64arr_ll_modulus *mod);
+
+// {r,mod->n} = {x,lx} % modulus
+// the cost is about 2 short products of mod->n limbs for each mod->n limbs
+// of x above mod->n, and no division
+void u64arr_ll_mod_pre(const uint64_t *__restrict__ x, size_t lx,
+                       const u64arr_ll_modulus *mod,
+                       uint64_t *__restrict__ r);
+
+// number of limbs of scratch space needed by u64arr_ll_mod_pre_scratch
+size_t u64arr_ll_mod_pre_itch(size_t lx, const u64arr_ll_modulus *mod);
+
+// same as u64arr_ll_mod_pre but does not allocate memory
+// t must have length >= u64arr_ll_mod_pre_itch(lx,mod) and not overlap
+// the others
+void u64arr_ll_mod_pre_scratch(const uint64_t *__restrict__ x, size_t lx,
+                               const u64arr_ll_modulus *mod,
+                               uint64_t *__restrict__ r,
+                               uint64_t *__restrict__ t);
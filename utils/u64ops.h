@@ -71,3 +71,58 @@ static inline void _udiv64_2(uint64_t u0, uint64_t u1, uint64_t d,
     if (q1) *q1 = u1q;
     _udiv64_1(u0,u1r,d,q0,r);
 }
+
+/*
+division by an invariant 64 bit integer using a precomputed reciprocal
+(Moller and Granlund, "Improved division by invariant integers", 2011)
+only multiplications are needed once the reciprocal is known
+*/
+
+// reciprocal of a normalized divisor d (highest bit set)
+// returns floor((2^128-1)/d) - 2^64
+static inline uint64_t _udiv64_reciprocal(uint64_t d)
+{
+    // (2^128-1 - d*2^64) / d, the quotient fits since ~d < d
+    uint64_t v;
+    _udiv64_1(~(uint64_t)0,~d,d,&v,NULL);
+    return v;
+}
+
+// divide 128 bit number (u0 + u1*2^64) by normalized d with reciprocal v
+// requires u1 < d so the quotient fits in 64 bits
+static inline void _udiv64_pre(uint64_t u0, uint64_t u1,
+                               uint64_t d, uint64_t v,
+                               uint64_t *q, uint64_t *r)
+{
+    __uint128_t p = (__uint128_t)v * u1 + (((__uint128_t)u1 << 64) | u0);
+    uint64_t qq = (uint64_t)(p >> 64) + 1;
+    uint64_t rr = u0 - qq*d;
+    if (rr > (uint64_t)p) // taken about half the time, compiles to cmov
+    {
+        --qq;
+        rr += d;
+    }
+    if (rr >= d) // unlikely
+    {
+        ++qq;
+        rr -= d;
+    }
+    if (q) *q = qq;
+    if (r) *r = rr;
+}
+
+/*
+inverse modulo 2^64 (for exact division by odd numbers)
+*/
+
+// returns x such that d*x = 1 mod 2^64, requires d to be odd
+// newton iteration x = x*(2-d*x) doubles the number of correct low bits
+static inline uint64_t _binvert64(uint64_t d)
+{
+    uint64_t x = (3*d) ^ 2; // correct to 5 bits
+    x *= 2 - d*x; // 10 bits
+    x *= 2 - d*x; // 20 bits
+    x *= 2 - d*x; // 40 bits
+    x *= 2 - d*x; // 80 bits
+    return x;
+}